@@ -27,50 +27,111 @@
 */
 
 #include "CCLayerPanZoom.h"
-
+#include <algorithm>
 
 USING_NS_CC;
 
+static PanZoomRect PanZoomRectWithNodeBoundingBox(CCNode* node)
+{
+    CCRect box = node->boundingBox();
+    return PanZoomRectMake(box.origin.x, box.origin.y, box.size.width, box.size.height);
+}
+
 void CCLayerPanZoom::setMaxScale(float maxScale)
 {
-    _maxScale = maxScale;
-    this->setScale(MIN(this->getScale(), _maxScale));
+    _controller.state.maxScale = maxScale;
+    this->setScale(MIN(this->getScale(), _controller.state.maxScale));
 }
 
 float CCLayerPanZoom::maxScale()
 {
-    return _maxScale;
+    return _controller.state.maxScale;
 }
 
 void CCLayerPanZoom::setMinScale(float minScale)
 {
-    _minScale = minScale;
+    _controller.state.minScale = minScale;
     this->setScale(MAX(this->getScale(), minScale));
 }
 
 float CCLayerPanZoom::minScale()
 {
-    return _minScale;
+    return _controller.state.minScale;
 }
 
 void CCLayerPanZoom::setRubberEffectRatio(float rubberEffectRatio)
 {
-    _rubberEffectRatio = rubberEffectRatio;
+    _controller.state.rubberEffectRatio = rubberEffectRatio;
 
     // Avoid turning rubber effect On in frame mode.
-    if (_mode == kCCLayerPanZoomModeFrame)
+    if (_controller.state.mode == kCCLayerPanZoomModeFrame)
     {
         CCLOGERROR("CCLayerPanZoom#setRubberEffectRatio: rubber effect is not supported in frame mode.");
-        _rubberEffectRatio = 0.0f;
+        _controller.state.rubberEffectRatio = 0.0f;
     }
 
 }
 
 float CCLayerPanZoom::rubberEffectRatio()
 {
-    return _rubberEffectRatio;
+    return _controller.state.rubberEffectRatio;
+}
+
+void CCLayerPanZoom::setMode(CCLayerPanZoomMode mode)
+{
+    if (_controller.state.mode != mode)
+    {
+        this->markDirty(kCCLayerPanZoomDirtyMode);
+    }
+    _controller.state.mode = mode;
+
+    // Rubber effect is not supported in frame mode.
+    if (_controller.state.mode == kCCLayerPanZoomModeFrame)
+    {
+        _controller.state.rubberEffectRatio = 0.0f;
+    }
+}
+
+CCLayerPanZoomMode CCLayerPanZoom::mode()
+{
+    return _controller.state.mode;
 }
 
+void CCLayerPanZoom::setClock(PanZoomClock* clock)
+{
+    clock = clock ? clock : PanZoomSystemClock::sharedClock();
+    if (_traceWriter.isOpen())
+    {
+        _tracedClock = clock;
+    }
+    else
+    {
+        _controller.clock = clock;
+    }
+}
+
+PanZoomClock* CCLayerPanZoom::clock()
+{
+    return _traceWriter.isOpen() ? _tracedClock : _controller.clock;
+}
+
+unsigned int CCLayerPanZoom::touchCount()
+{
+    return _controller.touchCount;
+}
+
+float CCLayerPanZoom::gestureRotation()
+{
+    return _controller.rotation;
+}
+
+#if CC_PANZOOM_ENABLE_STATS
+PanZoomStats& CCLayerPanZoom::stats()
+{
+    return _controller.stats;
+}
+#endif
+
 
 CCLayerPanZoom* CCLayerPanZoom::layer()
 {
@@ -81,7 +142,44 @@ CCLayerPanZoom* CCLayerPanZoom::layer()
     return layer;
 }
 
+// Members get their real defaults in init(), this only makes the destructor
+// safe when init() fails.
+CCLayerPanZoom::CCLayerPanZoom()
+: _scheduler(NULL)
+, _committedPrediction(PanZoomPointMake(0.0f, 0.0f))
+, _delegate(NULL)
+, _notifiedVersion(0)
+, _updateScheduled(false)
+, _tapCount(0)
+, _lastClickTime(-INFINITY)
+, _tracedClock(NULL)
+, _cullingEnabled(false)
+, _cullingMargin(0.0f)
+, _cullingDirty(true)
+, _cullingNeedsUpdate(false)
+, _culledRect(PanZoomRectMake(0.0f, 0.0f, 0.0f, 0.0f))
+, _spatialIndexEnabled(false)
+, _spatialIndexDirty(true)
+, _spatialIndexCellSize(kPanZoomSpatialIndexDefaultCellSize)
+, _tileProvider(NULL)
+, _tileContainer(NULL)
+, _tilesDirty(true)
+, _tiledLevel(-1)
+, _tiledRect(PanZoomRectMake(0.0f, 0.0f, 0.0f, 0.0f))
+, _tiledScale(0.0f)
+, _tiledZoomDirection(0)
+{
+    _notifiedTransform.position = CCPointZero;
+    _notifiedTransform.scale = 1.0f;
+}
+
 // on "init" you need to initialize your instance
+CCLayerPanZoom::~CCLayerPanZoom()
+{
+    this->stopRecording();
+    CC_SAFE_RELEASE(_tileContainer);
+}
+
 bool CCLayerPanZoom::init()
 {
     // 1. super init first
@@ -93,152 +191,120 @@ bool CCLayerPanZoom::init()
     //m_bIsRelativeAnchorPoint = true;
     m_bIsTouchEnabled = true;
 
-    _maxScale = 3.0f;
-    _minScale = 0.7f;
-    _touches = CCArray::createWithCapacity(10);
-    _touches->retain();
-
-    _panBoundsRect = CCRectZero;
-    _touchDistance = 0.0F;
-    _maxTouchDistanceToClick = 315.0f;
-
-    _mode = kCCLayerPanZoomModeSheet;
-    _minSpeed = 100.0f;
-    _maxSpeed = 1000.0f;
-    _topFrameMargin = 100.0f;
-    _bottomFrameMargin = 100.0f;
-    _leftFrameMargin = 100.0f;
-    _rightFrameMargin = 100.0f;
-
-    _rubberEffectRatio = 0.0f;
-    _rubberEffectRecoveryTime = 0.2f;
-    _rubberEffectRecovering = false;
-    _rubberEffectZooming = false;
+    PanZoomState& state = _controller.state;
+    state.maxScale = 3.0f;
+    state.minScale = 0.7f;
+    state.position = PanZoomPointMake(this->getPosition().x, this->getPosition().y);
+    state.scale = this->getScale();
+    state.anchorPoint = PanZoomPointMake(this->getAnchorPoint().x, this->getAnchorPoint().y);
+    state.contentSize = PanZoomSizeMake(this->getContentSize().width, this->getContentSize().height);
+    state.ignoreAnchorPointForPosition = this->isIgnoreAnchorPointForPosition();
+
+    state.panBoundsRect = PanZoomRectMake(0.0f, 0.0f, 0.0f, 0.0f);
+    _controller.touchDistance = 0.0F;
+    _controller.maxTouchDistanceToClick = 315.0f;
+
+    state.mode = kCCLayerPanZoomModeSheet;
+    _controller.frameSettings.minSpeed = 100.0f;
+    _controller.frameSettings.maxSpeed = 1000.0f;
+    _controller.frameSettings.topMargin = 100.0f;
+    _controller.frameSettings.bottomMargin = 100.0f;
+    _controller.frameSettings.leftMargin = 100.0f;
+    _controller.frameSettings.rightMargin = 100.0f;
+    _controller.frameSettings.precompute();
+
+    state.rubberEffectRatio = 0.0f;
+    _controller.rubberEffectRecoveryTime = 0.2f;
+    _controller.rubberEffectRecovering = false;
+
+    _cullingEnabled = false;
+    _cullingMargin = 0.0f;
+    _cullingDirty = true;
+    _cullingNeedsUpdate = false;
+    _culledRect = PanZoomRectMake(0.0f, 0.0f, 0.0f, 0.0f);
+
+    _spatialIndexEnabled = false;
+    _spatialIndexDirty = true;
+    _spatialIndexCellSize = kPanZoomSpatialIndexDefaultCellSize;
+
+    _tileProvider = NULL;
+    _tileContainer = NULL;
+    _tileCache.setBudget(kCCLayerPanZoomDefaultTileMemoryBudget);
+    _tilesDirty = true;
+    _tiledLevel = -1;
+    _tiledScale = 0.0f;
+    _tiledZoomDirection = 0;
+
+    _committedPrediction = PanZoomPointMake(0.0f, 0.0f);
+
+    _transformVersion = PanZoomTransformVersion();
+
+    _delegate = NULL;
+    _notifiedTransform = this->transform();
+    _notifiedVersion = 0;
+    _updateScheduled = false;
+    _tapCount = 0;
+    _lastClickTime = -INFINITY;
 
     return true;
 }
 
 void CCLayerPanZoom::ccTouchesBegan(cocos2d::CCSet *pTouches, cocos2d::CCEvent *pEvent){
+    CC_PANZOOM_STATS_COUNT(_controller.stats, kPanZoomStatTouchEvents, pTouches->count());
+    this->traceEvents(kPanZoomTouchBegan, pTouches, 0.0f);
+    this->flushTouches();
     CCTouch *pTouch;
     CCSetIterator setIter;
     for (setIter = pTouches->begin(); setIter != pTouches->end(); ++setIter)
     {
         pTouch = (CCTouch *)(*setIter);
-        _touches->addObject(pTouch);
+        CCPoint position = CCDirector::sharedDirector()->convertToGL(pTouch->getLocationInView());
+        _controller.addTouch(pTouch->getID(), PanZoomPointMake(position.x, position.y));
     }
 
-
-    if (_touches->count() == 1)
-    {
-        _touchMoveBegan = false;
-        time_t seconds;
-
-        seconds = time (NULL);
-        _singleTouchTimestamp = seconds/60;
-    }
-    else
-        _singleTouchTimestamp = INFINITY;
+    _controller.touchesBegan();
+    this->traceTransform();
+    this->updateScheduling();
 }
 
 void CCLayerPanZoom::ccTouchesMoved(cocos2d::CCSet *pTouches, cocos2d::CCEvent *pEvent){
-    bool multitouch = _touches->count() > 1;
-    if (multitouch)
+    CC_PANZOOM_STATS_TIME(_controller.stats, kPanZoomTimerTouchesMoved);
+    CC_PANZOOM_STATS_COUNT(_controller.stats, kPanZoomStatTouchEvents, pTouches->count());
+    this->traceEvents(kPanZoomTouchMoved, pTouches, 0.0f);
+    CCTouch *pTouch;
+    CCSetIterator setIter;
+    for (setIter = pTouches->begin(); setIter != pTouches->end(); ++setIter)
     {
-        // Get the two first touches
-        CCTouch *touch1 = (CCTouch*)_touches->objectAtIndex(0);
-        CCTouch *touch2 = (CCTouch*)_touches->objectAtIndex(1);
-        // Get current and previous positions of the touches
-        CCPoint curPosTouch1 = CCDirector::sharedDirector()->convertToGL(touch1->getLocationInView());
-        CCPoint curPosTouch2 = CCDirector::sharedDirector()->convertToGL(touch2->getLocationInView());
-
-        CCPoint prevPosTouch1 = CCDirector::sharedDirector()->convertToGL(touch1->getPreviousLocationInView());
-        CCPoint prevPosTouch2 = CCDirector::sharedDirector()->convertToGL(touch2->getPreviousLocationInView());
-
-
-        // Calculate current and previous positions of the layer relative the anchor point
-        CCPoint curPosLayer = ccpMidpoint(curPosTouch1, curPosTouch2);
-        CCPoint prevPosLayer = ccpMidpoint(prevPosTouch1, prevPosTouch2);
-
-        // Calculate new scale
-        float prevScale = this->getScale();
-
-
-        float curScale = this->getScale() * ccpDistance(curPosTouch1, curPosTouch2) / ccpDistance(prevPosTouch1, prevPosTouch2);
-
-        this->setScale( curScale);
-        // Avoid scaling out from panBoundsRect when Rubber Effect is OFF.
-        if (!_rubberEffectRatio)
-        {
-            this->setScale( MAX(this->getScale(), this->minPossibleScale())); 
-        }
-        // If scale was changed -> set new scale and fix position with new scale
-        if (this->getScale() != prevScale)
-        {
-            if (_rubberEffectRatio)
-            {
-                _rubberEffectZooming = true;
-            }
-            CCPoint realCurPosLayer = this->convertToNodeSpace(curPosLayer);
-            float deltaX = (realCurPosLayer.x - this->getAnchorPoint().x * this->getContentSize().width) * (this->getScale() - prevScale);
-            float deltaY = (realCurPosLayer.y - this->getAnchorPoint().y * this->getContentSize().height) * (this->getScale() - prevScale);
-            this->setPosition(ccp(this->getPosition().x - deltaX, this->getPosition().y - deltaY));
-            _rubberEffectZooming = false;
-        }
-        // If current and previous position of the multitouch's center aren't equal -> change position of the layer
-        if (!prevPosLayer.equals(curPosLayer))
-        {            
-            this->setPosition(ccp(this->getPosition().x + curPosLayer.x - prevPosLayer.x,
-                this->getPosition().y + curPosLayer.y - prevPosLayer.y));
-        }
-        // Don't click with multitouch
-        _touchDistance = INFINITY;
+        pTouch = (CCTouch *)(*setIter);
+        CCPoint position = CCDirector::sharedDirector()->convertToGL(pTouch->getLocationInView());
+        _controller.moveTouch(pTouch->getID(), PanZoomPointMake(position.x, position.y));
     }
-    else
-    {	        
-        // Get the single touch and it's previous & current position.
-        CCTouch *touch = (CCTouch*)_touches->objectAtIndex(0);
-        CCPoint curTouchPosition = CCDirector::sharedDirector()->convertToGL(touch->getLocationInView());
-        CCPoint prevTouchPosition = CCDirector::sharedDirector()->convertToGL(touch->getPreviousLocationInView());
-
-        // Always scroll in sheet mode.
-        if (_mode == kCCLayerPanZoomModeSheet)
-        {
-            // Set new position of the layer.
-            this->setPosition(ccp(this->getPosition().x + curTouchPosition.x - prevTouchPosition.x,
-                this->getPosition().y + curTouchPosition.y - prevTouchPosition.y));
-        }
 
-        // Accumulate touch distance for all modes.
-        _touchDistance += ccpDistance(curTouchPosition, prevTouchPosition);
+    this->panZoomState();
+    bool touchMoveBegan = _controller.touchesMoved();
+    this->commitState();
+    this->traceTransform();
+    this->updateScheduling();
 
-        // Inform delegate about starting updating touch position, if click isn't possible.
-        if (_mode == kCCLayerPanZoomModeFrame)
-        {
-            if (_touchDistance > _maxTouchDistanceToClick && !_touchMoveBegan)
-            {
-                //ToDo add delegate here
-                //[self.delegate layerPanZoom: self 
-                //  touchMoveBeganAtPosition: [self convertToNodeSpace: prevTouchPosition]];
-                _touchMoveBegan = true;
-            }
-        }
-    }	
+    // Inform delegate about starting updating touch position, if click isn't possible.
+    if (touchMoveBegan && _delegate)
+    {
+        _delegate->layerPanZoomTouchMoveBeganAtPosition(this, this->touchPositionInLayer());
+    }
 }
 
 void CCLayerPanZoom::ccTouchesEnded(cocos2d::CCSet *pTouches, cocos2d::CCEvent *pEvent){
-    _singleTouchTimestamp = INFINITY;
-
+    CC_PANZOOM_STATS_COUNT(_controller.stats, kPanZoomStatTouchEvents, pTouches->count());
+    this->traceEvents(kPanZoomTouchEnded, pTouches, 0.0f);
+    this->flushTouches();
     // Process click event in single touch.
-    //ToDo add delegate
-    if (  (_touchDistance < _maxTouchDistanceToClick) /*&& (self.delegate) */
-        && (_touches->count() == 1))
+    if (_controller.isClickPossible() && _delegate)
     {
-        CCTouch *touch = (CCTouch*)_touches->objectAtIndex(0);       
-        CCPoint curPos = CCDirector::sharedDirector()->convertToGL(touch->getLocationInView());
-        //ToDo add delegate
-        /*[self.delegate layerPanZoom: self
-        clickedAtPoint: [self convertToNodeSpace: curPos]
-        tapCount: [touch tapCount]];*/
+        // Clicks in quick succession count as multiple taps.
+        double now = _controller.clock->now();
+        _tapCount = now - _lastClickTime < kCCLayerPanZoomMultipleTapDelay ? _tapCount + 1 : 1;
+        _lastClickTime = now;
+        _delegate->layerPanZoomClickedAtPoint(this, this->touchPositionInLayer(), _tapCount);
     }
 
     CCTouch *pTouch;
@@ -246,390 +312,951 @@ void CCLayerPanZoom::ccTouchesEnded(cocos2d::CCSet *pTouches, cocos2d::CCEvent *
     for (setIter = pTouches->begin(); setIter != pTouches->end(); ++setIter)
     {
         pTouch = (CCTouch *)(*setIter);
-        _touches->removeObject(pTouch);
-    }
-
-    if (_touches->count() == 0)
-    {
-        _touchDistance = 0.0f;
+        _controller.removeTouch(pTouch->getID());
     }
 
-    if (!_touches->count() && !_rubberEffectRecovering)
-    {
-        this->recoverPositionAndScale();
-    }
+    this->panZoomState();
+    _controller.touchesEnded();
+    // The touch prediction is retracted, or kept in the fling position.
+    this->commitState();
+    this->traceTransform();
+    this->updateScheduling();
 }
 
 void CCLayerPanZoom::ccTouchesCancelled(cocos2d::CCSet *pTouches, cocos2d::CCEvent *pEvent){
+    CC_PANZOOM_STATS_COUNT(_controller.stats, kPanZoomStatTouchEvents, pTouches->count());
+    this->traceEvents(kPanZoomTouchCancelled, pTouches, 0.0f);
+    this->flushTouches();
 
     CCTouch *pTouch;
     CCSetIterator setIter;
     for (setIter = pTouches->begin(); setIter != pTouches->end(); ++setIter)
     {
         pTouch = (CCTouch *)(*setIter);
-        _touches->removeObject(pTouch);
+        _controller.removeTouch(pTouch->getID());
     }
 
-    if (_touches->count() == 0)
+    this->panZoomState();
+    _controller.touchesCancelled();
+    this->commitState();
+    this->traceTransform();
+    this->updateScheduling();
+}
+
+
+// Updates position in frame mode, while flinging, recovering and animating.
+void  CCLayerPanZoom::update(float dt){
+    CC_PANZOOM_STATS_END_FRAME(_controller.stats);
+    CC_PANZOOM_STATS_TIME(_controller.stats, kPanZoomTimerUpdate);
+    this->traceEvents(kPanZoomTouchFrame, NULL, dt);
+    this->panZoomState();
+
+    unsigned int events = _controller.update(dt);
+    this->commitState();
+    this->traceTransform();
+
+    if (events & kPanZoomUpdateRecoveryEnded)
     {
-        _touchDistance = 0.0f;
+        this->recoverEnded();
     }
+
+    if (_delegate)
+    {
+        this->notifyDelegate(events);
+    }
+    this->updateScheduling();
 }
 
+void CCLayerPanZoom::notifyDelegate(unsigned int events){
+    // Inform delegate about starting updating touch position, if coalesced
+    // moves made click impossible.
+    if (events & kPanZoomUpdateTouchMoveBegan && _controller.touchCount)
+    {
+        _delegate->layerPanZoomTouchMoveBeganAtPosition(this, this->touchPositionInLayer());
+    }
 
-// Updates position in frame mode.
-void  CCLayerPanZoom::update(float dt){
-    // Only for frame mode with one touch.
-    if ( _mode == kCCLayerPanZoomModeFrame && _touches->count() == 1 )
+    // Inform delegate if touch position in layer was changed due to finger or layer movement.
+    if (events & kPanZoomUpdateTouchPositionChanged)
     {
-        // Do not update position if click is still possible.
-        if (_touchDistance <= _maxTouchDistanceToClick)
-            return;
+        _delegate->layerPanZoomTouchPositionUpdated(this, this->touchPositionInLayer());
+    }
 
-        // Do not update position if pinch is still possible.
-        time_t seconds;
+    // One notification per frame for all changes since the previous one.
+    if (this->dirtyFlagsSinceVersion(_notifiedVersion) & (kCCLayerPanZoomDirtyPosition | kCCLayerPanZoomDirtyScale))
+    {
+        CCLayerPanZoomTransform oldTransform = _notifiedTransform;
+        _notifiedTransform = this->transform();
+        _notifiedVersion = _transformVersion.version;
+        _delegate->layerPanZoomTransformChanged(this, oldTransform, _notifiedTransform);
+    }
+}
 
-        seconds = time (NULL);
-        seconds /= 60;
-        if (seconds - _singleTouchTimestamp < kCCLayerPanZoomMultitouchGesturesDetectionDelay)
-            return;
+void CCLayerPanZoom::setDelegate(CCLayerPanZoomDelegate* delegate){
+    _delegate = delegate;
+    _notifiedTransform = this->transform();
+    _notifiedVersion = _transformVersion.version;
+    this->updateScheduling();
+}
 
-        // Otherwise - update touch position. Get current position of touch.
-        CCTouch *touch = (CCTouch*)_touches->objectAtIndex(0);
-        CCPoint curPos = CCDirector::sharedDirector()->convertToGL(touch->getLocationInView());
+CCLayerPanZoomDelegate* CCLayerPanZoom::delegate(){
+    return _delegate;
+}
 
-        // Scroll if finger in the scroll area near edge.
-        if (this->frameEdgeWithPoint(curPos) != kCCLayerPanZoomFrameEdgeNone)
-        {
-            this->setPosition(ccp(this->getPosition().x + dt * this->horSpeedWithPosition( curPos), 
-                this->getPosition().y + dt * this->vertSpeedWithPosition(curPos)));
-        }
+CCLayerPanZoomTransform CCLayerPanZoom::transform(){
+    CCLayerPanZoomTransform transform;
+    transform.position = this->getPosition();
+    transform.scale = this->getScale();
+    return transform;
+}
 
-        // Inform delegate if touch position in layer was changed due to finger or layer movement.
-        CCPoint touchPositionInLayer = this->convertToNodeSpace(curPos);
-        if (!_prevSingleTouchPositionInLayer.equals(touchPositionInLayer))
-        {
-            _prevSingleTouchPositionInLayer = touchPositionInLayer;
-            //ToDo add delegate
-            //[self.delegate layerPanZoom: self 
-            //      touchPositionUpdated: touchPositionInLayer];
-        }
+CCPoint CCLayerPanZoom::touchPositionInLayer(){
+    PanZoomPoint position = _controller.touches[0].position;
+    return this->convertToNodeSpace(ccp(position.x, position.y));
+}
 
+bool CCLayerPanZoom::startRecording(const char* path){
+    this->stopRecording();
+    if (!_traceWriter.open(path, _controller))
+    {
+        return false;
+    }
+    _tracedClock = _controller.clock;
+    _traceClock.setTime(_tracedClock->now());
+    _controller.clock = &_traceClock;
+    return true;
+}
+
+bool CCLayerPanZoom::stopRecording(){
+    if (!_traceWriter.isOpen())
+    {
+        return true;
+    }
+    _controller.clock = _tracedClock;
+    if (!_traceWriter.close())
+    {
+        CCLOG("CCLayerPanZoom: the trace couldn't be written completely");
+        return false;
+    }
+    return true;
+}
+
+bool CCLayerPanZoom::isRecording(){
+    return _traceWriter.isOpen();
+}
+
+void CCLayerPanZoom::traceEvents(PanZoomTouchPhase phase, CCSet* touches, float dt){
+    if (!_traceWriter.isOpen())
+    {
+        return;
+    }
+    // One clock time per handler, as the replay has.
+    _traceClock.setTime(_tracedClock->now());
+
+    PanZoomTouchEvent event;
+    event.phase = phase;
+    event.touchId = -1;
+    event.position = PanZoomPointMake(0.0f, 0.0f);
+    event.dt = dt;
+    event.time = _traceClock.now();
+    event.lastInBatch = true;
+    if (!touches)
+    {
+        _traceWriter.writeEvent(event);
+        return;
+    }
+
+    unsigned int index = 0;
+    unsigned int count = touches->count();
+    for (CCSetIterator setIter = touches->begin(); setIter != touches->end(); ++setIter)
+    {
+        CCTouch* touch = (CCTouch*)(*setIter);
+        CCPoint position = CCDirector::sharedDirector()->convertToGL(touch->getLocationInView());
+        event.touchId = touch->getID();
+        event.position = PanZoomPointMake(position.x, position.y);
+        event.lastInBatch = ++index == count;
+        _traceWriter.writeEvent(event);
+    }
+}
+
+void CCLayerPanZoom::traceTransform(){
+    if (_traceWriter.isOpen())
+    {
+        _traceWriter.writeTransform(_controller.state);
     }
 }
 
 void  CCLayerPanZoom::onEnter(){
     CCLayer::onEnter();
-    CCDirector::sharedDirector()->getScheduler()->scheduleUpdateForTarget(this, 0, false);
+    this->updateScheduling();
 }
 
 void  CCLayerPanZoom::onExit(){
     CCDirector::sharedDirector()->getScheduler()->unscheduleAllSelectorsForTarget(this);
+    _updateScheduled = false;
     CCLayer::onExit();
 }
+
+// update() is only scheduled while it has work, idle layers cost the 
+// scheduler nothing.
+void CCLayerPanZoom::updateScheduling(){
+    bool needsUpdate = _controller.needsUpdate() || 
+        (_delegate && (_controller.touchCount || (this->dirtyFlagsSinceVersion(_notifiedVersion) & 
+            (kCCLayerPanZoomDirtyPosition | kCCLayerPanZoomDirtyScale))));
+#if CC_PANZOOM_ENABLE_STATS
+    // update() closes the stats frames, one per frame of a gesture.
+    needsUpdate = needsUpdate || _controller.touchCount;
+#endif
+    needsUpdate = needsUpdate && this->isRunning();
+    if (needsUpdate == _updateScheduled)
+    {
+        return;
+    }
+    _updateScheduled = needsUpdate;
+    CCScheduler* scheduler = CCDirector::sharedDirector()->getScheduler();
+    if (needsUpdate)
+    {
+        scheduler->scheduleUpdateForTarget(this, 0, false);
+    }
+    else
+    {
+        scheduler->unscheduleUpdateForTarget(this);
+    }
+}
 void CCLayerPanZoom::setPanBoundsRect(CCRect rect){
-    _panBoundsRect = rect;
-    this->setScale(this->minPossibleScale());
-    this->setPosition(this->getPosition());
+    this->panZoomState();
+    _controller.state.panBoundsRect = PanZoomRectMake(rect.origin.x, rect.origin.y, rect.size.width, rect.size.height);
+    this->markDirty(kCCLayerPanZoomDirtyBounds);
+    _controller.setScale(_controller.state.minPossibleScale());
+    _controller.setPosition(_controller.state.position);
+    this->commitState();
+}
+
+CCRect CCLayerPanZoom::panBoundsRect(){
+    const PanZoomRect& rect = _controller.state.panBoundsRect;
+    return CCRectMake(rect.origin.x, rect.origin.y, rect.size.width, rect.size.height);
 }
 
 void CCLayerPanZoom::setPosition(CCPoint  position){
-    CCPoint prevPosition = this->getPosition();
-    //May be it wouldnot work
-    CCNode::setPosition(position);
+    CC_PANZOOM_STATS_TIME(_controller.stats, kPanZoomTimerSetPosition);
+    this->panZoomState();
+    _controller.setPosition(PanZoomPointMake(position.x, position.y));
+    this->commitState();
+}
+
+void CCLayerPanZoom::setScale(float scale){
+    this->panZoomState();
+    _controller.setScale(scale);
+    this->commitState();
+}
+
+void CCLayerPanZoom::setAnchorPoint(const CCPoint& anchorPoint){
+    CCLayer::setAnchorPoint(anchorPoint);
+    _controller.state.anchorPoint = PanZoomPointMake(anchorPoint.x, anchorPoint.y);
+    this->markDirty(kCCLayerPanZoomDirtyPosition);
+}
 
-    if (!_panBoundsRect.equals(CCRectZero) && !_rubberEffectZooming)
+void CCLayerPanZoom::setContentSize(const CCSize& contentSize){
+    CCLayer::setContentSize(contentSize);
+    _controller.state.contentSize = PanZoomSizeMake(contentSize.width, contentSize.height);
+    this->markDirty(kCCLayerPanZoomDirtyBounds);
+}
+
+void CCLayerPanZoom::ignoreAnchorPointForPosition(bool newValue){
+    CCLayer::ignoreAnchorPointForPosition(newValue);
+    _controller.state.ignoreAnchorPointForPosition = newValue;
+    this->markDirty(kCCLayerPanZoomDirtyPosition);
+}
+
+// Pushes position and scale computed by the controller to the node in one
+// step, so a gesture step invalidates the node transform once.
+void CCLayerPanZoom::commitState(){
+    const PanZoomState& state = _controller.state;
+    unsigned int dirtyFlags = kCCLayerPanZoomDirtyNone;
+    if (this->getScale() != state.scale)
+    {
+        CCLayer::setScale(state.scale);
+        dirtyFlags |= kCCLayerPanZoomDirtyScale;
+    }
+    _committedPrediction = _controller.predictionOffset;
+    CCPoint position = ccp(state.position.x + _committedPrediction.x, state.position.y + _committedPrediction.y);
+    if (this->getPosition().x != position.x || this->getPosition().y != position.y)
     {
-        if (_rubberEffectRatio && _mode == kCCLayerPanZoomModeSheet)
+        CCNode::setPosition(position);
+        dirtyFlags |= kCCLayerPanZoomDirtyPosition;
+    }
+    if (dirtyFlags)
+    {
+        this->markDirty(dirtyFlags);
+        // The delegate hears about the change on the next frame.
+        if (_delegate)
         {
-            if (!_rubberEffectRecovering)
-            {
-                float topDistance = this->topEdgeDistance();
-                float bottomDistance = this->bottomEdgeDistance();
-                float leftDistance = this->leftEdgeDistance();
-                float rightDistance = this->rightEdgeDistance();
-                float dx = this->getPosition().x - prevPosition.x;
-                float dy = this->getPosition().y - prevPosition.y;
-                if (bottomDistance || topDistance)
-                {
-                    CCNode::setPosition(ccp(this->getPosition().x, 
-                        prevPosition.y + dy * _rubberEffectRatio));                    
-                }
-                if (leftDistance || rightDistance)
-                {
-                    CCNode::setPosition(ccp(prevPosition.x + dx * _rubberEffectRatio, 
-                        this->getPosition().y));                    
-                }
-            }
-        }
-        else
-        {
-            CCRect boundBox = this->boundingBox();
-            if (this->getPosition().x - boundBox.size.width * this->getAnchorPoint().x > _panBoundsRect.origin.x)
-            {
-                CCNode::setPosition(ccp(boundBox.size.width * this->getAnchorPoint().x + _panBoundsRect.origin.x, 
-                    this->getPosition().y));
-            }	
-            if (this->getPosition().y - boundBox.size.height * this->getAnchorPoint().y > _panBoundsRect.origin.y)
-            {
-                CCNode::setPosition(ccp(this->getPosition().x, boundBox.size.height * this->getAnchorPoint().y + 
-                    _panBoundsRect.origin.y));
-            }
-            if (this->getPosition().x + boundBox.size.width * (1 - this->getAnchorPoint().x) < _panBoundsRect.size.width +
-                _panBoundsRect.origin.x)
-            {
-                CCNode::setPosition(ccp(_panBoundsRect.size.width + _panBoundsRect.origin.x - 
-                    boundBox.size.width * (1 - this->getAnchorPoint().x), this->getPosition().y));
-            }
-            if (this->getPosition().y + boundBox.size.height * (1 - this->getAnchorPoint().y) < _panBoundsRect.size.height + 
-                _panBoundsRect.origin.y)
-            {
-                CCNode::setPosition(ccp(this->getPosition().x, _panBoundsRect.size.height + _panBoundsRect.origin.y - 
-                    boundBox.size.height * (1 - this->getAnchorPoint().y)));
-            }	
+            this->updateScheduling();
         }
     }
 }
 
-void CCLayerPanZoom::setScale(float scale){
-    CCLayer::setScale( MIN(MAX(scale, _minScale), _maxScale));
+void CCLayerPanZoom::markDirty(unsigned int dirtyFlags){
+    _transformVersion.markDirty(dirtyFlags);
+}
+
+unsigned int CCLayerPanZoom::transformVersion(){
+    return _transformVersion.version;
+}
+
+unsigned int CCLayerPanZoom::dirtyFlagsSinceVersion(unsigned int version){
+    return _transformVersion.dirtyFlagsSince(version);
+}
+
+void CCLayerPanZoom::flushTouches(){
+    if (_controller.hasPendingTouchMoves())
+    {
+        this->panZoomState();
+        _controller.flushTouches();
+        this->commitState();
+    }
 }
 
+void CCLayerPanZoom::panToPoint(CCPoint point, float duration, CCLayerPanZoomEasing easing){
+    PanZoomRect viewport = this->viewport();
+    this->panZoomState();
+    _controller.animateTo(PanZoomPointMake(point.x, point.y), 
+        PanZoomPointMake(viewport.origin.x + viewport.size.width * 0.5f, viewport.origin.y + viewport.size.height * 0.5f),
+        _controller.state.scale, duration, easing);
+    this->commitState();
+    this->updateScheduling();
+}
+
+void CCLayerPanZoom::zoomAroundPoint(CCPoint point, float scale, float duration, CCLayerPanZoomEasing easing){
+    PanZoomPoint nodePoint = PanZoomPointMake(point.x, point.y);
+    _controller.animateTo(nodePoint, this->panZoomState().convertToParentSpace(nodePoint), 
+        scale, duration, easing);
+    this->commitState();
+    this->updateScheduling();
+}
+
+void CCLayerPanZoom::zoomToRect(CCRect rect, float duration, CCLayerPanZoomEasing easing){
+    this->panZoomState();
+    _controller.animateToRect(PanZoomRectMake(rect.origin.x, rect.origin.y, rect.size.width, rect.size.height), 
+        this->viewport(), duration, easing);
+    this->commitState();
+    this->updateScheduling();
+}
+
+void CCLayerPanZoom::stopAnimation(){
+    _controller.stopAnimation();
+}
+
+bool CCLayerPanZoom::isAnimating(){
+    return _controller.animating;
+}
+
+// Springs the layer back into panBoundsRect from update(), no actions are used.
 void CCLayerPanZoom::recoverPositionAndScale(){
-    if (!_panBoundsRect.equals(CCRectZero))
-    {    
-        CCSize winSize = CCDirector::sharedDirector()->getWinSize();
-        float rightEdgeDistance = this->rightEdgeDistance();
-        float leftEdgeDistance = this->leftEdgeDistance();
-        float topEdgeDistance = this->topEdgeDistance();
-        float bottomEdgeDistance = this->bottomEdgeDistance();
-        float scale = this->minPossibleScale();
-
-        if (!rightEdgeDistance && !leftEdgeDistance && !topEdgeDistance && !bottomEdgeDistance)
+    this->panZoomState();
+    _controller.recoverPositionAndScale();
+    this->updateScheduling();
+}
+
+// Called when the recovery reached its target.
+void CCLayerPanZoom::recoverEnded(){
+    _controller.rubberEffectRecovering = false;
+}
+
+void CCLayerPanZoom::setCullingEnabled(bool cullingEnabled){
+    _cullingEnabled = cullingEnabled;
+    _cullingDirty = true;
+    if (!_cullingEnabled)
+    {
+        this->uncullAllChildren();
+    }
+}
+
+bool CCLayerPanZoom::isCullingEnabled(){
+    return _cullingEnabled;
+}
+
+void CCLayerPanZoom::setCullingMargin(float cullingMargin){
+    _cullingMargin = cullingMargin;
+    _cullingNeedsUpdate = true;
+}
+
+float CCLayerPanZoom::cullingMargin(){
+    return _cullingMargin;
+}
+
+void CCLayerPanZoom::setCullingDirty(){
+    _cullingDirty = true;
+    _spatialIndexDirty = true;
+}
+
+CCRect CCLayerPanZoom::visibleRect(){
+    PanZoomRect rect = this->panZoomState().visibleRect(this->viewport());
+    return CCRectMake(rect.origin.x, rect.origin.y, rect.size.width, rect.size.height);
+}
+
+unsigned int CCLayerPanZoom::culledChildrenCount(){
+    return (unsigned int)_culledChildren.size();
+}
+
+void CCLayerPanZoom::setSpatialIndexEnabled(bool spatialIndexEnabled){
+    _spatialIndexEnabled = spatialIndexEnabled;
+    _spatialIndexDirty = true;
+    _cullingDirty = true;
+    if (!_spatialIndexEnabled)
+    {
+        _spatialIndex.clear();
+        _unculledChildren.clear();
+    }
+}
+
+bool CCLayerPanZoom::isSpatialIndexEnabled(){
+    return _spatialIndexEnabled;
+}
+
+void CCLayerPanZoom::setSpatialIndexCellSize(float spatialIndexCellSize){
+    _spatialIndexCellSize = spatialIndexCellSize;
+    _spatialIndexDirty = true;
+}
+
+float CCLayerPanZoom::spatialIndexCellSize(){
+    return _spatialIndexCellSize;
+}
+
+void CCLayerPanZoom::childMoved(CCNode* child){
+    if (_spatialIndexEnabled)
+    {
+        _spatialIndex.update(child, PanZoomRectWithNodeBoundingBox(child));
+        if (_cullingEnabled)
         {
-            return;
+            // Check whether it left the view on the next culling.
+            _unculledChildren.push_back(child);
         }
+    }
+    _cullingNeedsUpdate = true;
+}
 
-        if (this->getScale() < scale)
+CCNode* CCLayerPanZoom::childAtPoint(CCPoint point){
+    if (_spatialIndexEnabled)
+    {
+        this->syncSpatialIndex();
+        _spatialHits.clear();
+        _spatialIndex.queryPoint(PanZoomPointMake(point.x, point.y), _spatialHits);
+        for (size_t i = 0; i < _spatialHits.size(); ++i)
         {
-            _rubberEffectRecovering = true;
-            CCPoint newPosition = CCPointZero;
-            if (rightEdgeDistance && leftEdgeDistance && topEdgeDistance && bottomEdgeDistance)
-            {
-                float dx = scale * this->getContentSize().width * (this->getAnchorPoint().x - 0.5f);
-                float dy = scale * this->getContentSize().height * (this->getAnchorPoint().y - 0.5f);
-                newPosition = ccp(winSize.width * 0.5f + dx, winSize.height * 0.5f + dy);
-            }
-            else if (rightEdgeDistance && leftEdgeDistance && topEdgeDistance)
-            {
-                float dx = scale * this->getContentSize().width * (this->getAnchorPoint().x - 0.5f);
-                float dy = scale * this->getContentSize().height * (1.0f - this->getAnchorPoint().y);            
-                newPosition = ccp(winSize.width * 0.5f + dx, winSize.height - dy);
-            }
-            else if (rightEdgeDistance && leftEdgeDistance && bottomEdgeDistance)
-            {
-                float dx = scale * this->getContentSize().width * (this->getAnchorPoint().x - 0.5f);
-                float dy = scale * this->getContentSize().height * this->getAnchorPoint().y;            
-                newPosition = ccp(winSize.width * 0.5f + dx, dy);
-            }
-            else if (rightEdgeDistance && topEdgeDistance && bottomEdgeDistance)
+            CCNode* child = (CCNode*)_spatialHits[i];
+            if (child->isVisible())
             {
-                float dx = scale * this->getContentSize().width * (1.0f - this->getAnchorPoint().x);
-                float dy = scale * this->getContentSize().height * (this->getAnchorPoint().y - 0.5f);            
-                newPosition = ccp(winSize.width  - dx, winSize.height  * 0.5f + dy);
+                return child;
             }
-            else if (leftEdgeDistance && topEdgeDistance && bottomEdgeDistance)
-            {
-                float dx = scale * this->getContentSize().width * this->getAnchorPoint().x;
-                float dy = scale * this->getContentSize().height * (this->getAnchorPoint().y - 0.5f);            
-                newPosition = ccp(dx, winSize.height * 0.5f + dy);
-            }
-            else if (leftEdgeDistance && topEdgeDistance)
-            {
-                float dx = scale * this->getContentSize().width * this->getAnchorPoint().x;
-                float dy = scale * this->getContentSize().height * (1.0f - this->getAnchorPoint().y);            
-                newPosition = ccp(dx, winSize.height - dy);
-            } 
-            else if (leftEdgeDistance && bottomEdgeDistance)
-            {
-                float dx = scale * this->getContentSize().width * this->getAnchorPoint().x;
-                float dy = scale * this->getContentSize().height * this->getAnchorPoint().y;            
-                newPosition = ccp(dx, dy);
-            } 
-            else if (rightEdgeDistance && topEdgeDistance)
-            {
-                float dx = scale * this->getContentSize().width * (1.0f - this->getAnchorPoint().x);
-                float dy = scale * this->getContentSize().height * (1.0f - this->getAnchorPoint().y);            
-                newPosition = ccp(winSize.width - dx, winSize.height - dy);
-            } 
-            else if (rightEdgeDistance && bottomEdgeDistance)
-            {
-                float dx = scale * this->getContentSize().width * (1.0f - this->getAnchorPoint().x);
-                float dy = scale * this->getContentSize().height * this->getAnchorPoint().y;            
-                newPosition = ccp(winSize.width - dx, dy);
-            } 
-            else if (topEdgeDistance || bottomEdgeDistance)
-            {
-                float dy = scale * this->getContentSize().height * (this->getAnchorPoint().y - 0.5f);            
-                newPosition = ccp(this->getPosition().x, winSize.height * 0.5f + dy);
-            }
-            else if (leftEdgeDistance || rightEdgeDistance)
-            {
-                float dx = scale * this->getContentSize().width * (this->getAnchorPoint().x - 0.5f);
-                newPosition = ccp(winSize.width * 0.5f + dx, this->getPosition().y);
-            } 
-
-            CCMoveTo *moveToPosition = CCMoveTo::create( _rubberEffectRecoveryTime,newPosition);
-            CCScaleTo *scaleToPosition = CCScaleTo::create( _rubberEffectRecoveryTime,scale);
-            CCFiniteTimeAction *sequence = CCSpawn::create(scaleToPosition, moveToPosition, CCCallFunc::create( this, callfunc_selector(CCLayerPanZoom::recoverEnded)), NULL);
-            this->runAction(sequence);
+        }
+        return NULL;
+    }
 
+    CCNode* topmost = NULL;
+    CCObject* object = NULL;
+    CCARRAY_FOREACH(this->getChildren(), object)
+    {
+        CCNode* child = (CCNode*)object;
+        if (!child->isVisible() || 
+            !PanZoomRectContainsPoint(PanZoomRectWithNodeBoundingBox(child), PanZoomPointMake(point.x, point.y)))
+        {
+            continue;
         }
-        else
+        if (!topmost || child->getZOrder() > topmost->getZOrder() || 
+            (child->getZOrder() == topmost->getZOrder() && child->getOrderOfArrival() > topmost->getOrderOfArrival()))
         {
-            _rubberEffectRecovering = false;
-            CCMoveTo *moveToPosition = CCMoveTo::create(_rubberEffectRecoveryTime,ccp(this->getPosition().x + rightEdgeDistance - leftEdgeDistance, 
-                this->getPosition().y + topEdgeDistance - bottomEdgeDistance));
-            CCFiniteTimeAction *sequence = CCSpawn::create(moveToPosition, CCCallFunc::create( this, callfunc_selector(CCLayerPanZoom::recoverEnded)), NULL);
-            this->runAction(sequence);
-
+            topmost = child;
         }
     }
+    return topmost;
 }
 
-void CCLayerPanZoom::recoverEnded(){
-    _rubberEffectRecovering = false;
+void CCLayerPanZoom::childrenInRect(CCRect rect, std::vector<CCNode*>& result){
+    PanZoomRect queryRect = PanZoomRectMake(rect.origin.x, rect.origin.y, rect.size.width, rect.size.height);
+    if (_spatialIndexEnabled)
+    {
+        this->syncSpatialIndex();
+        _spatialHits.clear();
+        _spatialIndex.query(queryRect, _spatialHits);
+        for (size_t i = 0; i < _spatialHits.size(); ++i)
+        {
+            result.push_back((CCNode*)_spatialHits[i]);
+        }
+        return;
+    }
+
+    CCObject* object = NULL;
+    CCARRAY_FOREACH(this->getChildren(), object)
+    {
+        CCNode* child = (CCNode*)object;
+        if (PanZoomRectIntersects(queryRect, PanZoomRectWithNodeBoundingBox(child)))
+        {
+            result.push_back(child);
+        }
+    }
 }
 
-float CCLayerPanZoom::topEdgeDistance(){
-    CCRect boundBox = this->boundingBox();
-    return (int)(MAX(_panBoundsRect.size.height + _panBoundsRect.origin.y - this->getPosition().y - 
-        boundBox.size.height * (1 - this->getAnchorPoint().y), 0));
+PanZoomRect CCLayerPanZoom::viewport(){
+    if (_controller.state.hasPanBounds())
+    {
+        return _controller.state.panBoundsRect;
+    }
+    CCSize winSize = CCDirector::sharedDirector()->getWinSize();
+    return PanZoomRectMake(0.0f, 0.0f, winSize.width, winSize.height);
 }
 
-float CCLayerPanZoom::leftEdgeDistance(){
-    CCRect boundBox = this->boundingBox();
-    return (int)(MAX(this->getPosition().x - boundBox.size.width * this->getAnchorPoint().x - _panBoundsRect.origin.x, 0));
-}    
+void CCLayerPanZoom::visit(){
+    if (_cullingEnabled)
+    {
+        this->updateCulling();
+    }
+    if (_tileProvider)
+    {
+        this->updateTiles();
+    }
+    if (_culledChildren.empty())
+    {
+        CCLayer::visit();
+        return;
+    }
 
-float CCLayerPanZoom::bottomEdgeDistance(){
-    CCRect boundBox = this->boundingBox();
-    return (int)(MAX(this->getPosition().y - boundBox.size.height * this->getAnchorPoint().y - _panBoundsRect.origin.y, 0));
+    // CCNode::visit(), skipping the culled children, so their visibility 
+    // stays as the application set it.
+    if (!m_bVisible)
+    {
+        return;
+    }
+    kmGLPushMatrix();
+    if (m_pGrid && m_pGrid->isActive())
+    {
+        m_pGrid->beforeDraw();
+    }
+    this->transform();
+
+    this->sortAllChildren();
+    unsigned int count = m_pChildren ? m_pChildren->count() : 0;
+    unsigned int i = 0;
+    for (; i < count; ++i)
+    {
+        CCNode* child = (CCNode*)m_pChildren->objectAtIndex(i);
+        if (child->getZOrder() >= 0)
+        {
+            break;
+        }
+        if (!_culledChildren.count(child))
+        {
+            child->visit();
+        }
+    }
+    this->draw();
+    for (; i < count; ++i)
+    {
+        CCNode* child = (CCNode*)m_pChildren->objectAtIndex(i);
+        if (!_culledChildren.count(child))
+        {
+            child->visit();
+        }
+    }
+
+    // Reset for the next frame, as CCNode::visit() does.
+    m_uOrderOfArrival = 0;
+    if (m_pGrid && m_pGrid->isActive())
+    {
+        m_pGrid->afterDraw(this);
+    }
+    kmGLPopMatrix();
 }
 
-float CCLayerPanZoom::rightEdgeDistance(){
-    CCRect boundBox = this->boundingBox();
-    return (int)(MAX(_panBoundsRect.size.width + _panBoundsRect.origin.x - this->getPosition().x - 
-        boundBox.size.width * (1 - this->getAnchorPoint().x), 0));
+void CCLayerPanZoom::draw(){
+    CCLayer::draw();
+    if (_tileContainer)
+    {
+        _tileContainer->visit();
+    }
 }
 
-float CCLayerPanZoom::minPossibleScale(){
-    if (!_panBoundsRect.equals(CCRectZero))
+void CCLayerPanZoom::setTileProvider(CCLayerPanZoomTileProvider* tileProvider, float tileSize, int levelCount){
+    this->reloadTiles();
+    _tileProvider = tileProvider;
+    if (_tileProvider)
     {
-        return MAX(_panBoundsRect.size.width / this->getContentSize().width,
-            _panBoundsRect.size.height /this->getContentSize().height);
+        _tileProvider->tilesReloaded();
     }
-    else 
+    _tiling.tileSize = tileSize;
+    _tiling.levelCount = MAX(levelCount, 1);
+    if (_tileProvider && !_tileContainer)
     {
-        return _minScale;
+        _tileContainer = CCNode::create();
+        _tileContainer->retain();
+    }
+    else if (!_tileProvider && _tileContainer)
+    {
+        _tileContainer->release();
+        _tileContainer = NULL;
     }
 }
 
-CCLayerPanZoomFrameEdge CCLayerPanZoom::frameEdgeWithPoint( CCPoint point){
-    bool isLeft = point.x <= _panBoundsRect.origin.x + _leftFrameMargin;
-    bool isRight = point.x >= _panBoundsRect.origin.x + _panBoundsRect.size.width - _rightFrameMargin;
-    bool isBottom = point.y <= _panBoundsRect.origin.y + _bottomFrameMargin;
-    bool isTop = point.y >= _panBoundsRect.origin.y + _panBoundsRect.size.height - _topFrameMargin;
+CCLayerPanZoomTileProvider* CCLayerPanZoom::tileProvider(){
+    return _tileProvider;
+}
+
+void CCLayerPanZoom::setTileMemoryBudget(unsigned int tileMemoryBudget){
+    _tileCache.setBudget(tileMemoryBudget);
+    this->evictTiles();
+}
+
+unsigned int CCLayerPanZoom::tileMemoryBudget(){
+    return _tileCache.budget();
+}
+
+unsigned int CCLayerPanZoom::tileMemoryUsage(){
+    return _tileCache.memoryUsage();
+}
+
+unsigned int CCLayerPanZoom::residentTileCount(){
+    return _tileCache.count();
+}
 
-    if (isLeft && isBottom)
+PanZoomTileCache& CCLayerPanZoom::tileCache(){
+    return _tileCache;
+}
+
+void CCLayerPanZoom::reloadTiles(){
+    _removedTiles.clear();
+    _tileCache.clear(_removedTiles);
+    this->removeTileNodes();
+    _missingTiles.clear();
+    _tilesDirty = true;
+    if (_tileProvider)
     {
-        return kCCLayerPanZoomFrameEdgeBottomLeft;
+        _tileProvider->tilesReloaded();
     }
-    if (isLeft && isTop)
+}
+
+void CCLayerPanZoom::updateTiles(){
+    const PanZoomState& state = this->panZoomState();
+    PanZoomRect rect = state.visibleRect(this->viewport());
+    int level = _tiling.levelForScale(state.scale);
+    if (!_tilesDirty && level == _tiledLevel && PanZoomRectEqual(rect, _tiledRect))
     {
-        return kCCLayerPanZoomFrameEdgeTopLeft;
+        return;
     }
-    if (isRight && isBottom)
+    _tilesDirty = false;
+    _tiledLevel = level;
+    _tiledRect = rect;
+    if (state.scale != _tiledScale)
     {
-        return kCCLayerPanZoomFrameEdgeBottomRight;
+        _tiledZoomDirection = state.scale > _tiledScale ? 1 : -1;
+        _tiledScale = state.scale;
     }
-    if (isRight && isTop)
+    _tiling.contentSize = state.contentSize;
+
+    _neededTiles.clear();
+    _tiling.tilesInRect(rect, level, _neededTiles);
+    _tiling.sortTilesByDistance(_neededTiles, 
+        PanZoomPointMake(rect.origin.x + rect.size.width * 0.5f, rect.origin.y + rect.size.height * 0.5f));
+
+    // Missing visible tiles, then tiles ahead of the pan and of the zoom.
+    _wantedTiles.clear();
+    this->addWantedTiles(_neededTiles);
+    PanZoomPoint velocity = _controller.flinging ? _controller.flingVelocity : 
+        (_controller.touchCount == 1 ? _controller.touchVelocity() : PanZoomPointMake(0.0f, 0.0f));
+    if (velocity.x != 0.0f || velocity.y != 0.0f)
     {
-        return kCCLayerPanZoomFrameEdgeTopRight;
+        // The view moves over the content against the layer.
+        PanZoomRect ahead = rect;
+        ahead.origin.x -= velocity.x / state.scale * kCCLayerPanZoomTilePrefetchTime;
+        ahead.origin.y -= velocity.y / state.scale * kCCLayerPanZoomTilePrefetchTime;
+        _prefetchTiles.clear();
+        _tiling.tilesInRect(ahead, level, _prefetchTiles);
+        this->addWantedTiles(_prefetchTiles);
     }
-
-    if (isLeft)
+    int zoomLevel = level - _tiledZoomDirection;
+    if (zoomLevel != level && zoomLevel >= 0 && zoomLevel < _tiling.levelCount)
     {
-        return kCCLayerPanZoomFrameEdgeLeft;
+        _prefetchTiles.clear();
+        _tiling.tilesInRect(rect, zoomLevel, _prefetchTiles);
+        this->addWantedTiles(_prefetchTiles);
     }
-    if (isTop)
+    _tileProvider->prefetchTiles(_wantedTiles);
+
+    // Only the visible tiles of the current level are pinned.
+    _tileCache.unpinAll();
+    _stillMissingTiles.clear();
+    for (size_t i = 0; i < _neededTiles.size(); ++i)
     {
-        return kCCLayerPanZoomFrameEdgeTop;
+        const PanZoomTileKey& key = _neededTiles[i];
+        // A missing tile is never cached, only its first lookup counts.
+        bool missing = std::binary_search(_missingTiles.begin(), _missingTiles.end(), key);
+        if (missing || !_tileCache.get(key))
+        {
+            CCNode* node = _tileProvider->tileNode(key);
+            if (!node)
+            {
+                _stillMissingTiles.push_back(key);
+                continue;
+            }
+            PanZoomRect tileRect = _tiling.tileRect(key);
+            node->setAnchorPoint(CCPointZero);
+            node->setPosition(ccp(tileRect.origin.x, tileRect.origin.y));
+            node->setScale(ldexpf(1.0f, key.level));
+            // Finer tiles on top.
+            _tileContainer->addChild(node, _tiling.levelCount - key.level);
+            _tileCache.insert(key, node, _tileProvider->tileMemorySize(key, node));
+        }
+        _tileCache.setPinned(key, true);
     }
-    if (isRight)
+    std::sort(_stillMissingTiles.begin(), _stillMissingTiles.end());
+    _missingTiles.swap(_stillMissingTiles);
+    bool levelComplete = _missingTiles.empty();
+
+    // Coarser or finer tiles fill the holes while the level is incomplete.
+    const PanZoomTileCache::TileList& tiles = _tileCache.tiles();
+    for (PanZoomTileCache::TileList::const_iterator tile = tiles.begin(); tile != tiles.end(); ++tile)
     {
-        return kCCLayerPanZoomFrameEdgeRight;
+        ((CCNode*)tile->tile)->setVisible(tile->pinned || 
+            (!levelComplete && PanZoomRectIntersects(rect, _tiling.tileRect(tile->key))));
     }
-    if (isBottom)
+
+    this->evictTiles();
+    // Missing tiles may arrive later.
+    _tilesDirty = !levelComplete;
+}
+
+void CCLayerPanZoom::addWantedTiles(const std::vector<PanZoomTileKey>& tiles){
+    for (size_t i = 0; i < tiles.size(); ++i)
     {
-        return kCCLayerPanZoomFrameEdgeBottom;
+        if (!_tileCache.contains(tiles[i]) && 
+            std::find(_wantedTiles.begin(), _wantedTiles.end(), tiles[i]) == _wantedTiles.end())
+        {
+            _wantedTiles.push_back(tiles[i]);
+        }
     }
+}
 
-    return kCCLayerPanZoomFrameEdgeNone;
+void CCLayerPanZoom::evictTiles(){
+    _removedTiles.clear();
+    _tileCache.evict(_removedTiles);
+    this->removeTileNodes();
 }
 
-float CCLayerPanZoom::horSpeedWithPosition(CCPoint pos){
-    CCLayerPanZoomFrameEdge edge = this->frameEdgeWithPoint(pos);
-    float speed = 0.0f;
-    if (edge == kCCLayerPanZoomFrameEdgeLeft)
+void CCLayerPanZoom::removeTileNodes(){
+    for (size_t i = 0; i < _removedTiles.size(); ++i)
+    {
+        _tileContainer->removeChild((CCNode*)_removedTiles[i], true);
+    }
+    _removedTiles.clear();
+}
+
+void CCLayerPanZoom::updateCulling(){
+    PanZoomRect rect = PanZoomRectOutset(this->panZoomState().visibleRect(this->viewport()), _cullingMargin);
+    if (!_cullingDirty && !_cullingNeedsUpdate && PanZoomRectEqual(rect, _culledRect))
     {
-        speed = _minSpeed + (_maxSpeed - _minSpeed) * 
-            (_panBoundsRect.origin.x + _leftFrameMargin - pos.x) / _leftFrameMargin;
+        return;
+    }
+    bool fullPass = _cullingDirty || !_spatialIndexEnabled;
+    _cullingDirty = false;
+    _cullingNeedsUpdate = false;
+    _culledRect = rect;
+
+    if (!fullPass)
+    {
+        // Only children in the view now or in the view last time can change.
+        this->syncSpatialIndex();
+        _spatialHits.clear();
+        _spatialIndex.query(rect, _spatialHits);
+        for (size_t i = 0; i < _spatialHits.size(); ++i)
+        {
+            this->uncullChild((CCNode*)_spatialHits[i]);
+        }
+        for (size_t i = 0; i < _unculledChildren.size(); ++i)
+        {
+            if (!_spatialIndex.isInLastQuery(_unculledChildren[i]))
+            {
+                this->cullChild((CCNode*)_unculledChildren[i]);
+            }
+        }
+        _unculledChildren.swap(_spatialHits);
+        return;
     }
-    if (edge == kCCLayerPanZoomFrameEdgeBottomLeft || edge == kCCLayerPanZoomFrameEdgeTopLeft)
+
+    if (_spatialIndexEnabled)
     {
-        speed = _minSpeed + (_maxSpeed - _minSpeed) * 
-            (_panBoundsRect.origin.x + _leftFrameMargin - pos.x) / (_leftFrameMargin * sqrt(2.0f));
+        this->syncSpatialIndex();
+        _unculledChildren.clear();
+        _spatialIndex.query(rect, _unculledChildren);
     }
-    if (edge == kCCLayerPanZoomFrameEdgeRight)
+    CCObject* object = NULL;
+    CCARRAY_FOREACH(this->getChildren(), object)
     {
-        speed = - (_minSpeed + (_maxSpeed - _minSpeed) * 
-            (pos.x - _panBoundsRect.origin.x - _panBoundsRect.size.width + 
-            _rightFrameMargin) / _rightFrameMargin);
+        CCNode* child = (CCNode*)object;
+        bool inView = _spatialIndexEnabled ? _spatialIndex.isInLastQuery(child) : 
+            PanZoomRectIntersects(rect, PanZoomRectWithNodeBoundingBox(child));
+        if (inView)
+        {
+            this->uncullChild(child);
+        }
+        else
+        {
+            this->cullChild(child);
+        }
     }
-    if (edge == kCCLayerPanZoomFrameEdgeBottomRight || edge == kCCLayerPanZoomFrameEdgeTopRight)
+}
+
+void CCLayerPanZoom::cullChild(CCNode* child){
+    if (_culledChildren.insert(child).second)
     {
-        speed = - (_minSpeed + (_maxSpeed - _minSpeed) * 
-            (pos.x - _panBoundsRect.origin.x - _panBoundsRect.size.width + 
-            _rightFrameMargin) / (_rightFrameMargin * sqrt(2.0f)));
+        CC_PANZOOM_STATS_COUNT(_controller.stats, kPanZoomStatChildrenCulled, 1);
     }
-    return speed;
 }
 
-float CCLayerPanZoom::vertSpeedWithPosition(CCPoint pos){
-    CCLayerPanZoomFrameEdge edge = this->frameEdgeWithPoint(pos);
-    float speed = 0.0f;
-    if (edge == kCCLayerPanZoomFrameEdgeBottom)
+void CCLayerPanZoom::uncullChild(CCNode* child){
+    _culledChildren.erase(child);
+}
+
+void CCLayerPanZoom::uncullAllChildren(){
+    _culledChildren.clear();
+    _unculledChildren.clear();
+}
+
+void CCLayerPanZoom::syncSpatialIndex(){
+    PanZoomRect grid = PanZoomRectMake(0.0f, 0.0f, _controller.state.contentSize.width, _controller.state.contentSize.height);
+    if (_spatialIndexDirty)
+    {
+        _spatialIndexDirty = false;
+        _spatialIndex.clear();
+        _spatialIndex.setGrid(grid, _spatialIndexCellSize);
+        CCObject* object = NULL;
+        CCARRAY_FOREACH(this->getChildren(), object)
+        {
+            CCNode* child = (CCNode*)object;
+            _spatialIndex.insert(child, PanZoomRectWithNodeBoundingBox(child), child->getZOrder(), (unsigned int)child->getOrderOfArrival());
+        }
+    }
+    else if (!PanZoomRectEqual(grid, _spatialIndex.bounds()))
     {
-        speed = _minSpeed + (_maxSpeed - _minSpeed) * 
-            (_panBoundsRect.origin.y + _bottomFrameMargin - pos.y) / _bottomFrameMargin;
+        _spatialIndex.setGrid(grid, _spatialIndexCellSize);
     }
-    if (edge == kCCLayerPanZoomFrameEdgeBottomLeft || edge == kCCLayerPanZoomFrameEdgeBottomRight)
+}
+
+void CCLayerPanZoom::addChild(CCNode* child){
+    this->addChild(child, child->getZOrder(), child->getTag());
+}
+
+void CCLayerPanZoom::addChild(CCNode* child, int zOrder){
+    this->addChild(child, zOrder, child->getTag());
+}
+
+void CCLayerPanZoom::addChild(CCNode* child, int zOrder, int tag){
+    CCLayer::addChild(child, zOrder, tag);
+    if (_spatialIndexEnabled)
     {
-        speed = _minSpeed + (_maxSpeed - _minSpeed) * 
-            (_panBoundsRect.origin.y + _bottomFrameMargin - pos.y) / (_bottomFrameMargin * sqrt(2.0f));
+        _spatialIndex.insert(child, PanZoomRectWithNodeBoundingBox(child), child->getZOrder(), (unsigned int)child->getOrderOfArrival());
+        _unculledChildren.push_back(child);
     }
-    if (edge == kCCLayerPanZoomFrameEdgeTop)
+    _cullingNeedsUpdate = true;
+}
+
+void CCLayerPanZoom::reorderChild(CCNode* child, int zOrder){
+    CCLayer::reorderChild(child, zOrder);
+    if (_spatialIndexEnabled)
     {
-        speed = - (_minSpeed + (_maxSpeed - _minSpeed) * 
-            (pos.y - _panBoundsRect.origin.y - _panBoundsRect.size.height + 
-            _topFrameMargin) / _topFrameMargin);
+        _spatialIndex.setOrder(child, child->getZOrder(), (unsigned int)child->getOrderOfArrival());
     }
-    if (edge == kCCLayerPanZoomFrameEdgeTopLeft || edge == kCCLayerPanZoomFrameEdgeTopRight)
+}
+
+void CCLayerPanZoom::removeChild(CCNode* child){
+    this->removeChild(child, true);
+}
+
+void CCLayerPanZoom::removeChild(CCNode* child, bool cleanup){
+    this->uncullChild(child);
+    _spatialIndex.remove(child);
+    _unculledChildren.erase(std::remove(_unculledChildren.begin(), _unculledChildren.end(), (void*)child), 
+        _unculledChildren.end());
+    CCLayer::removeChild(child, cleanup);
+}
+
+void CCLayerPanZoom::removeAllChildrenWithCleanup(bool cleanup){
+    this->uncullAllChildren();
+    _spatialIndex.clear();
+    CCLayer::removeAllChildrenWithCleanup(cleanup);
+}
+
+void CCLayerPanZoom::convertToScreen(const float* xy, float* out, size_t n){
+    this->panZoomState().convertToParentSpace(xy, out, n);
+}
+
+void CCLayerPanZoom::convertFromScreen(const float* xy, float* out, size_t n){
+    this->panZoomState().convertToNodeSpace(xy, out, n);
+}
+
+const PanZoomState& CCLayerPanZoom::panZoomState(){
+    // Actions move the node through CCNode::setPosition. The node is shown 
+    // ahead by the touch prediction, which mustn't round the state.
+    PanZoomPoint& position = _controller.state.position;
+    if (this->getPosition().x != position.x + _committedPrediction.x || 
+        this->getPosition().y != position.y + _committedPrediction.y)
     {
-        speed = - (_minSpeed + (_maxSpeed - _minSpeed) * 
-            (pos.y - _panBoundsRect.origin.y - _panBoundsRect.size.height + 
-            _topFrameMargin) / (_topFrameMargin * sqrt(2.0f)));
+        position = PanZoomPointMake(this->getPosition().x - _committedPrediction.x, 
+            this->getPosition().y - _committedPrediction.y);
     }
-    return speed;
-} 
+    return _controller.state;
+}
+
+float CCLayerPanZoom::topEdgeDistance(){
+    return this->panZoomState().topEdgeDistance();
+}
+
+float CCLayerPanZoom::leftEdgeDistance(){
+    return this->panZoomState().leftEdgeDistance();
+}    
+
+float CCLayerPanZoom::bottomEdgeDistance(){
+    return this->panZoomState().bottomEdgeDistance();
+}
+
+float CCLayerPanZoom::rightEdgeDistance(){
+    return this->panZoomState().rightEdgeDistance();
+}
+
+PanZoomPositionLimits CCLayerPanZoom::positionLimits(){
+    return _controller.state.positionLimits();
+}
+
+CCPoint CCLayerPanZoom::clampPosition(CCPoint position, const PanZoomPositionLimits& limits){
+    PanZoomPoint clamped = PanZoomState::clampPosition(PanZoomPointMake(position.x, position.y), limits);
+    return ccp(clamped.x, clamped.y);
+}
+
+float CCLayerPanZoom::minPossibleScale(){
+    return this->panZoomState().minPossibleScale();
+}
+
+void CCLayerPanZoom::setEdgeSpeedCurve(CCLayerPanZoomEdgeSpeedCurve speedCurve){
+    _controller.frameSettings.speedCurve = speedCurve;
+    _controller.frameSettings.precompute();
+}
+
+CCLayerPanZoomEdgeSpeedCurve CCLayerPanZoom::edgeSpeedCurve(){
+    return _controller.frameSettings.speedCurve;
+}
+
+void CCLayerPanZoom::setCustomEdgeSpeedCurve(const float* values, unsigned int count){
+    _controller.frameSettings.setCustomSpeedCurve(values, count);
+}
+
+CCLayerPanZoomFrameEdge CCLayerPanZoom::frameEdgeWithPoint( CCPoint point){
+    return PanZoomFrameEdgeWithPoint(_controller.state.panBoundsRect, _controller.frameSettings, 
+        PanZoomPointMake(point.x, point.y));
+}
+
+float CCLayerPanZoom::horSpeedWithPosition(CCPoint pos){
+    return PanZoomHorSpeedWithPosition(_controller.state.panBoundsRect, _controller.frameSettings, 
+        PanZoomPointMake(pos.x, pos.y));
+}
+
+float CCLayerPanZoom::vertSpeedWithPosition(CCPoint pos){
+    return PanZoomVertSpeedWithPosition(_controller.state.panBoundsRect, _controller.frameSettings, 
+        PanZoomPointMake(pos.x, pos.y));
+}
@@ -26,54 +26,89 @@
 *
 */
 
+#ifndef __CCLAYERPANZOOM_H__
+#define __CCLAYERPANZOOM_H__
+
 #include "cocos2d.h"
+#include "PanZoomController.h"
+#include "PanZoomSpatialIndex.h"
+#include "PanZoomTileCache.h"
+#include "PanZoomTiling.h"
+#include "PanZoomTrace.h"
+
+#include <set>
+#include <vector>
+
 USING_NS_CC;
 
-#define kCCLayerPanZoomMultitouchGesturesDetectionDelay 0.5
+// Like CC_SYNTHESIZE, but the value is stored in the gesture controller.
+#define CC_PANZOOM_SYNTHESIZE(varType, member, funName)\
+public: virtual varType get##funName(void) const { return _controller.member; }\
+public: virtual void set##funName(varType var){ _controller.member = var; }
 
-#ifndef INFINITY
-#ifdef _MSC_VER
-union MSVC_EVIL_FLOAT_HACK
-{
-    unsigned __int8 Bytes[4];
-    float Value;
-};
-static union MSVC_EVIL_FLOAT_HACK INFINITY_HACK = {{0x00, 0x00, 0x80, 0x7F}};
-#define INFINITY (INFINITY_HACK.Value)
-#endif
+// Same for frame settings, the setter refreshes the precomputed edge speeds.
+#define CC_PANZOOM_SYNTHESIZE_FRAME_SETTING(member, funName)\
+public: virtual float get##funName(void) const { return _controller.frameSettings.member; }\
+public: virtual void set##funName(float var){ _controller.frameSettings.member = var; _controller.frameSettings.precompute(); }
 
-#ifdef __GNUC__
-#define INFINITY (__builtin_inf())
-#endif
+#define kCCLayerPanZoomDefaultTileMemoryBudget (32 * 1024 * 1024)
+// How far ahead along the pan velocity tiles are prefetched, in seconds.
+#define kCCLayerPanZoomTilePrefetchTime 0.5f
 
-#ifndef INFINITY
-#define INFINITY (1e1000)
-#endif
-#endif
+// Clicks this close together (seconds) increase the tap count.
+#define kCCLayerPanZoomMultipleTapDelay 0.3
 
+class CCLayerPanZoom;
 
-typedef enum
+// Position and scale of a CCLayerPanZoom.
+struct CCLayerPanZoomTransform
 {
-    /** Standard mode: swipe to scroll */
-    kCCLayerPanZoomModeSheet,
-    /** Frame mode (i.e. drag inside objects): hold finger at edge of the screen to the sroll in this direction */
-    kCCLayerPanZoomModeFrame  
-} CCLayerPanZoomMode;
-
+    CCPoint position;
+    float scale;
+};
 
-typedef enum
+// Receives gestures and transform changes of a CCLayerPanZoom, see 
+// CCLayerPanZoom::setDelegate. Points are in layer space.
+class CCLayerPanZoomDelegate
 {
-    kCCLayerPanZoomFrameEdgeNone,
-    kCCLayerPanZoomFrameEdgeTop,
-    kCCLayerPanZoomFrameEdgeBottom,
-    kCCLayerPanZoomFrameEdgeLeft,
-    kCCLayerPanZoomFrameEdgeRight,
-    kCCLayerPanZoomFrameEdgeTopLeft,
-    kCCLayerPanZoomFrameEdgeBottomLeft,
-    kCCLayerPanZoomFrameEdgeTopRight,
-    kCCLayerPanZoomFrameEdgeBottomRight
-} CCLayerPanZoomFrameEdge;
+public:
+    virtual ~CCLayerPanZoomDelegate() {}
+    // Single touch ended before moving further than maxTouchDistanceToClick.
+    // tapCount counts clicks in quick succession.
+    virtual void layerPanZoomClickedAtPoint(CCLayerPanZoom* /*layer*/, CCPoint /*point*/, unsigned int /*tapCount*/) {}
+    // Frame mode: the touch moved too far to be a click.
+    virtual void layerPanZoomTouchMoveBeganAtPosition(CCLayerPanZoom* /*layer*/, CCPoint /*point*/) {}
+    // Frame mode: touch position in layer changed due to finger or layer movement.
+    virtual void layerPanZoomTouchPositionUpdated(CCLayerPanZoom* /*layer*/, CCPoint /*point*/) {}
+    // Position or scale changed since the previous notification. Sent at most
+    // once per frame from update(), covering every change since the last one.
+    virtual void layerPanZoomTransformChanged(CCLayerPanZoom* /*layer*/, 
+        const CCLayerPanZoomTransform& /*oldTransform*/, const CCLayerPanZoomTransform& /*newTransform*/) {}
+};
 
+// Supplies the content of a tiled layer, see CCLayerPanZoom::setTileProvider.
+class CCLayerPanZoomTileProvider
+{
+public:
+    virtual ~CCLayerPanZoomTileProvider() {}
+    // Node drawing the tile with one point per tile pixel, e.g. a sprite of
+    // tileSize x tileSize pixels (smaller at the content edges). NULL if the
+    // tile isn't available yet, it is asked for again on the next frame. The
+    // layer retains the node while the tile is resident.
+    virtual CCNode* tileNode(const PanZoomTileKey& key) = 0;
+    // Tiles the layer is missing or expects to need soon (ahead of the pan
+    // velocity, the next level while zooming), most urgent first. Called 
+    // before tileNode() whenever the wanted tiles may have changed.
+    virtual void prefetchTiles(const std::vector<PanZoomTileKey>& /*tiles*/) {}
+    // The layer dropped its tiles (reloadTiles() or the provider was set), so
+    // anything remembered about them, e.g. failed tiles, should be forgotten.
+    virtual void tilesReloaded() {}
+    // Memory held by a resident tile, RGBA8888 by default.
+    virtual unsigned int tileMemorySize(const PanZoomTileKey& /*key*/, CCNode* node)
+    {
+        return (unsigned int)(node->getContentSize().width * node->getContentSize().height) * 4;
+    }
+};
 
 class CCLayerPanZoom : public cocos2d::CCLayer
 {
@@ -87,46 +122,81 @@ public:
     // implement the "static node()" method manually
     CREATE_FUNC(CCLayerPanZoom);
 
+    CCLayerPanZoom();
+    virtual ~CCLayerPanZoom();
+
     void setMaxScale(float maxScale);
     float maxScale();
     void setMinScale(float minScale);
     float minScale(); 
     void setRubberEffectRatio(float rubberEffectRatio);
     float rubberEffectRatio();
+    void setMode(CCLayerPanZoomMode mode);
+    CCLayerPanZoomMode mode();
+    // Clock used for gesture timing (not retained), NULL restores the 
+    // monotonic system clock.
+    void setClock(PanZoomClock* clock);
+    PanZoomClock* clock();
+    // Number of touches currently tracked by the layer.
+    unsigned int touchCount();
+    // Twist of the current multi-touch gesture in degrees, clockwise like
+    // setRotation(), while rotationEnabled. The layer doesn't rotate itself.
+    float gestureRotation();
+#if CC_PANZOOM_ENABLE_STATS
+    // Touch events, clamps, recoveries, culled children and time spent in 
+    // the touch, update and setPosition handlers; a frame per update(). 
+    // update() runs while touches are down or the layer has work, anything
+    // counted while it is idle adds to the next frame.
+    PanZoomStats& stats();
+#endif
 
-    //ToDo add delegate
-    CC_SYNTHESIZE(float, _maxTouchDistanceToClick, maxTouchDistanceToClick);
-    CC_SYNTHESIZE(CCArray*, _touches, touches);
-    CC_SYNTHESIZE(float, _touchDistance, touchDistance);
-    CC_SYNTHESIZE(float, _minSpeed, minSpeed);
-    CC_SYNTHESIZE(float, _maxSpeed, maxSpeed);
-    CC_SYNTHESIZE(float, _topFrameMargin, topFrameMargin);
-    CC_SYNTHESIZE(float, _bottomFrameMargin, bottomFrameMargin);
-    CC_SYNTHESIZE(float, _leftFrameMargin, leftFrameMargin);
-    CC_SYNTHESIZE(float, _rightFrameMargin, rightFrameMargin);
+    // Gestures and transform changes are reported to the delegate (not 
+    // retained). Without one no notification work is done.
+    void setDelegate(CCLayerPanZoomDelegate* delegate);
+    CCLayerPanZoomDelegate* delegate();
+    // Position and scale of the node as displayed.
+    CCLayerPanZoomTransform transform();
+    // Incremented whenever position, scale, bounds or mode change. Consumers
+    // keep the version they last handled and return early while it matches.
+    unsigned int transformVersion();
+    // CCLayerPanZoomDirtyFlag bits of the changes made after version.
+    unsigned int dirtyFlagsSinceVersion(unsigned int version);
 
-    CC_SYNTHESIZE(CCScheduler*, _scheduler, scheduler);
-    CC_SYNTHESIZE(float, _rubberEffectRecoveryTime, rubberEffectRecoveryTime);
+    CC_PANZOOM_SYNTHESIZE(float, maxTouchDistanceToClick, maxTouchDistanceToClick);
+    CC_PANZOOM_SYNTHESIZE(float, touchDistance, touchDistance);
+    CC_PANZOOM_SYNTHESIZE_FRAME_SETTING(minSpeed, minSpeed);
+    CC_PANZOOM_SYNTHESIZE_FRAME_SETTING(maxSpeed, maxSpeed);
+    CC_PANZOOM_SYNTHESIZE_FRAME_SETTING(topMargin, topFrameMargin);
+    CC_PANZOOM_SYNTHESIZE_FRAME_SETTING(bottomMargin, bottomFrameMargin);
+    CC_PANZOOM_SYNTHESIZE_FRAME_SETTING(leftMargin, leftFrameMargin);
+    CC_PANZOOM_SYNTHESIZE_FRAME_SETTING(rightMargin, rightFrameMargin);
+    // Speed across the frame margins, linear by default. Custom curves take
+    // count >= 2 samples from 0 (minSpeed) to 1 (maxSpeed) spread evenly 
+    // from the inner side of a margin to the bounds.
+    void setEdgeSpeedCurve(CCLayerPanZoomEdgeSpeedCurve speedCurve);
+    CCLayerPanZoomEdgeSpeedCurve edgeSpeedCurve();
+    void setCustomEdgeSpeedCurve(const float* values, unsigned int count);
 
-    CCRect _panBoundsRect;
-    float _maxScale;
-    float _minScale;
+    // Inertial scrolling in sheet mode.
+    CC_PANZOOM_SYNTHESIZE(bool, flingEnabled, flingEnabled);
+    CC_PANZOOM_SYNTHESIZE(float, flingFriction, flingFriction);
+    CC_PANZOOM_SYNTHESIZE(float, flingMinVelocity, flingMinVelocity);
 
-    CCLayerPanZoomMode _mode;
+    // Rotation extraction for gestures with two or more fingers.
+    CC_PANZOOM_SYNTHESIZE(bool, rotationEnabled, rotationEnabled);
 
-    CCPoint _prevSingleTouchPositionInLayer; 
-    //< previous position in layer if single touch was moved.
+    // Run one gesture step per frame with the latest touch positions instead
+    // of one per touch event, for touch panels sampling faster than the frame
+    // rate. Clicks see the same touchDistance either way.
+    CC_PANZOOM_SYNTHESIZE(bool, coalesceTouches, coalesceTouches);
 
-    // Time when single touch has began, used to wait for possible multitouch 
-    // gestures before reacting to single touch.
-    double _singleTouchTimestamp; 
+    // Show the layer this far ahead (seconds, about one or two frames) of the
+    // last touch while panning in sheet mode, extrapolated from the finger's
+    // velocity and acceleration. 0 (default) disables prediction.
+    CC_PANZOOM_SYNTHESIZE(float, predictionTime, predictionTime);
 
-    // Flag used to call touchMoveBeganAtPosition: only once for each single touch event.
-    bool _touchMoveBegan;
-
-    float _rubberEffectRatio;
-    bool _rubberEffectRecovering;
-    bool _rubberEffectZooming;
+    CC_SYNTHESIZE(CCScheduler*, _scheduler, scheduler);
+    CC_PANZOOM_SYNTHESIZE(float, rubberEffectRecoveryTime, rubberEffectRecoveryTime);
 
     //CCStandartTouchDelegate
     void ccTouchesBegan(cocos2d::CCSet *pTouches, cocos2d::CCEvent *pEvent);
@@ -134,27 +204,219 @@ public:
     void ccTouchesEnded(cocos2d::CCSet *pTouches, cocos2d::CCEvent *pEvent);
     void ccTouchesCancelled(cocos2d::CCSet *pTouches, cocos2d::CCEvent *pEvent);
 
-    // Updates position in frame mode.
+    // Records every touch event and frame with the resulting transform to a
+    // binary trace at path (replay it with PanZoomTraceRecording). While 
+    // recording, each handler sees one clock time so replays are bit exact;
+    // moving the layer from outside the handlers breaks that, as does 
+    // changing settings, which are saved when recording starts.
+    bool startRecording(const char* path);
+    // Returns false when the trace couldn't be written completely.
+    bool stopRecording();
+    bool isRecording();
+
+    // Updates position in frame mode, while flinging, recovering and animating.
+    // Scheduled only while there is such work, or while touches are down
+    // when stats or a delegate need a call per frame.
     virtual void update(float dt);
     void onEnter();
     void onExit();
 
     //Scale and Position related
     void setPanBoundsRect(CCRect rect);
+    CCRect panBoundsRect();
     void setPosition(CCPoint  position);
     void setScale(float scale);
+    void setAnchorPoint(const CCPoint& anchorPoint);
+    void setContentSize(const CCSize& contentSize);
+    void ignoreAnchorPointForPosition(bool newValue);
+
+    // Animated moves run by update() and cancelled by touches. Points and 
+    // rects are in layer space; scales are limited like pinches and the 
+    // layer stays within panBoundsRect. A zero duration jumps right away.
+    // Centers point in the viewport (panBoundsRect or the window).
+    void panToPoint(CCPoint point, float duration, 
+        CCLayerPanZoomEasing easing = kCCLayerPanZoomEasingEaseInOut);
+    // Zooms to scale keeping point where it is on the screen.
+    void zoomAroundPoint(CCPoint point, float scale, float duration, 
+        CCLayerPanZoomEasing easing = kCCLayerPanZoomEasingEaseInOut);
+    // Centers rect in the viewport, zoomed to fit it.
+    void zoomToRect(CCRect rect, float duration, 
+        CCLayerPanZoomEasing easing = kCCLayerPanZoomEasingEaseInOut);
+    void stopAnimation();
+    bool isAnimating();
 
     //Ruber Edges related
     void recoverPositionAndScale();
     void recoverEnded();
 
+    // Culling: children whose bounding box lies outside the visible rect plus
+    // cullingMargin are hidden before drawing. Culling is recomputed when the
+    // transform or the children change; call setCullingDirty() after moving
+    // children. Culled children are skipped while drawing, isVisible() and
+    // setVisible() are left to the application.
+    void setCullingEnabled(bool cullingEnabled);
+    bool isCullingEnabled();
+    void setCullingMargin(float cullingMargin);
+    float cullingMargin();
+    void setCullingDirty();
+    // Viewport (panBoundsRect or the window) in layer space.
+    CCRect visibleRect();
+    unsigned int culledChildrenCount();
+
+    // Spatial index: a uniform grid over the content size that tracks child
+    // bounding boxes, so culling and hit-testing only look at children near 
+    // the queried area. Children added and removed through the layer are 
+    // indexed automatically; call childMoved() after moving, scaling or 
+    // resizing a child.
+    void setSpatialIndexEnabled(bool spatialIndexEnabled);
+    bool isSpatialIndexEnabled();
+    void setSpatialIndexCellSize(float spatialIndexCellSize);
+    float spatialIndexCellSize();
+    void childMoved(CCNode* child);
+    // Topmost visible child containing point (in layer space) or NULL.
+    CCNode* childAtPoint(CCPoint point);
+    // Appends children whose bounding box intersects rect (in layer space).
+    void childrenInRect(CCRect rect, std::vector<CCNode*>& result);
+
+    // Tiles: the content size is split into tiles at levelCount levels of 
+    // detail (see PanZoomTiling). Only tiles intersecting the visible rect 
+    // at the level matching the current scale are requested from the 
+    // provider (not retained, NULL disables tiling). Tiles are drawn below 
+    // children with non negative z order; tiles out of the view are evicted
+    // least recently used first, once tile memory exceeds the budget.
+    void setTileProvider(CCLayerPanZoomTileProvider* tileProvider, float tileSize, int levelCount);
+    CCLayerPanZoomTileProvider* tileProvider();
+    void setTileMemoryBudget(unsigned int tileMemoryBudget);
+    unsigned int tileMemoryBudget();
+    unsigned int tileMemoryUsage();
+    unsigned int residentTileCount();
+    // Resident tiles with hit, miss and eviction counts.
+    PanZoomTileCache& tileCache();
+    // Drops all tiles, e.g. when the provider content changed.
+    void reloadTiles();
+
+    virtual void visit();
+    virtual void draw();
+    virtual void addChild(CCNode* child);
+    virtual void addChild(CCNode* child, int zOrder);
+    virtual void addChild(CCNode* child, int zOrder, int tag);
+    virtual void reorderChild(CCNode* child, int zOrder);
+    virtual void removeChild(CCNode* child);
+    virtual void removeChild(CCNode* child, bool cleanup);
+    virtual void removeAllChildrenWithCleanup(bool cleanup);
+
+    // Batch conversions of n points stored as x, y pairs between layer space
+    // and screen (the parent's space, the screen when the parent is the 
+    // scene); out may be xy. One tight SSE/NEON loop instead of a 
+    // convertToNodeSpace call per point.
+    void convertToScreen(const float* xy, float* out, size_t n);
+    void convertFromScreen(const float* xy, float* out, size_t n);
+
     //Helpers
     float topEdgeDistance();
     float leftEdgeDistance();
     float bottomEdgeDistance();    
     float rightEdgeDistance();
+    // Limits of the layer position at the current scale. Use with 
+    // clampPosition() to clamp many candidate positions, e.g. fling targets.
+    PanZoomPositionLimits positionLimits();
+    static CCPoint clampPosition(CCPoint position, const PanZoomPositionLimits& limits);
     float minPossibleScale();
     CCLayerPanZoomFrameEdge frameEdgeWithPoint( cocos2d::CCPoint point);
     float horSpeedWithPosition(CCPoint pos);
     float vertSpeedWithPosition(CCPoint pos);
-};
\ No newline at end of file
+    const PanZoomState& panZoomState();
+
+protected:
+    // Gesture state, position, scale and limits shared with the engine 
+    // independent code. Subclasses changing it call commitState().
+    PanZoomController _controller;
+    // Shows the controller state on the node.
+    void commitState();
+
+private:
+    // Steps coalesced touch moves before the set of touches changes.
+    void flushTouches();
+    void traceEvents(PanZoomTouchPhase phase, CCSet* touches, float dt);
+    void traceTransform();
+    PanZoomRect viewport();
+    void updateCulling();
+    void cullChild(CCNode* child);
+    void uncullChild(CCNode* child);
+    void uncullAllChildren();
+    void syncSpatialIndex();
+
+    // Prediction offset included in the node position by commitState.
+    PanZoomPoint _committedPrediction;
+
+    PanZoomTransformVersion _transformVersion;
+    void markDirty(unsigned int dirtyFlags);
+
+    CCLayerPanZoomDelegate* _delegate;
+    // Transform sent with the last layerPanZoomTransformChanged.
+    CCLayerPanZoomTransform _notifiedTransform;
+    unsigned int _notifiedVersion;
+    void notifyDelegate(unsigned int events);
+
+    bool _updateScheduled;
+    // Schedules update() while the layer has work for it, unschedules it
+    // once the work is done. With stats or a delegate it stays scheduled 
+    // while touches are down, so a drag doesn't reschedule it on every move.
+    void updateScheduling();
+    unsigned int _tapCount;
+    double _lastClickTime;
+    // First touch converted to layer space.
+    CCPoint touchPositionInLayer();
+
+    PanZoomTraceWriter _traceWriter;
+    // Clock the controller reads while recording, set from _tracedClock 
+    // once per handler.
+    PanZoomManualClock _traceClock;
+    PanZoomClock* _tracedClock;
+
+    bool _cullingEnabled;
+    float _cullingMargin;
+    // Dirty culling checks every child, otherwise only the ones near the 
+    // view are checked when the spatial index is enabled.
+    bool _cullingDirty;
+    bool _cullingNeedsUpdate;
+    PanZoomRect _culledRect;
+    // Children outside the view at the last culling, whether visible or not.
+    std::set<CCNode*> _culledChildren;
+    // Children in the view at the last culling, plus moved and added ones.
+    std::vector<void*> _unculledChildren;
+
+    bool _spatialIndexEnabled;
+    bool _spatialIndexDirty;
+    float _spatialIndexCellSize;
+    PanZoomSpatialIndex _spatialIndex;
+    std::vector<void*> _spatialHits;
+
+    void updateTiles();
+    void addWantedTiles(const std::vector<PanZoomTileKey>& tiles);
+    void evictTiles();
+    void removeTileNodes();
+
+    CCLayerPanZoomTileProvider* _tileProvider;
+    PanZoomTiling _tiling;
+    // Parent of the tile nodes, visited from draw().
+    CCNode* _tileContainer;
+    // Resident tile nodes, the visible ones pinned.
+    PanZoomTileCache _tileCache;
+    std::vector<void*> _removedTiles;
+    std::vector<PanZoomTileKey> _neededTiles;
+    std::vector<PanZoomTileKey> _wantedTiles;
+    std::vector<PanZoomTileKey> _prefetchTiles;
+    // Visible tiles the provider didn't have yet, sorted. Their retries 
+    // aren't counted as cache misses again.
+    std::vector<PanZoomTileKey> _missingTiles;
+    std::vector<PanZoomTileKey> _stillMissingTiles;
+    bool _tilesDirty;
+    int _tiledLevel;
+    PanZoomRect _tiledRect;
+    float _tiledScale;
+    // Sign of the last scale change.
+    int _tiledZoomDirection;
+};
+
+#endif // __CCLAYERPANZOOM_H__
\ No newline at end of file
@@ -0,0 +1,189 @@
+/*
+* CCLayerPanZoom
+*
+* Copyright (c) 2011 Alexey Lang
+* Copyright (c) 2011 Pavel Guganov
+*
+* http://www.cocos2d-x.org
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*
+*/
+
+
+#include "CCLayerPanZoomAsyncTileProvider.h"
+
+#include <algorithm>
+#include <stdio.h>
+
+USING_NS_CC;
+
+CCLayerPanZoomFileTileDecoder::CCLayerPanZoomFileTileDecoder(const char* directory, const char* fileFormat)
+    : _directory(CCFileUtils::sharedFileUtils()->fullPathFromRelativePath(directory)),
+      _fileFormat(fileFormat)
+{
+    if (!_directory.empty() && _directory[_directory.size() - 1] != '/')
+    {
+        _directory += '/';
+    }
+}
+
+bool CCLayerPanZoomFileTileDecoder::decode(const PanZoomTileKey& key, PanZoomTileImage& image)
+{
+    char fileName[256];
+    snprintf(fileName, sizeof(fileName), _fileFormat.c_str(), key.level, key.x, key.y);
+    std::string path = _directory + fileName;
+    size_t dot = path.rfind('.');
+    std::string extension = dot == std::string::npos ? "" : path.substr(dot + 1);
+    CCImage::EImageFormat format = (extension == "jpg" || extension == "jpeg") ? CCImage::kFmtJpg : CCImage::kFmtPng;
+
+    CCImage decoded;
+    if (!decoded.initWithImageFileThreadSafe(path.c_str(), format) || !decoded.getData())
+    {
+        return false;
+    }
+
+    // CCImage keeps 24 bit data for images without alpha.
+    image.width = decoded.getWidth();
+    image.height = decoded.getHeight();
+    unsigned int pixelCount = image.width * image.height;
+    const unsigned char* data = decoded.getData();
+    if (decoded.hasAlpha())
+    {
+        image.pixels.assign(data, data + pixelCount * 4);
+    }
+    else
+    {
+        image.pixels.resize(pixelCount * 4);
+        for (unsigned int i = 0; i < pixelCount; ++i)
+        {
+            image.pixels[i * 4] = data[i * 3];
+            image.pixels[i * 4 + 1] = data[i * 3 + 1];
+            image.pixels[i * 4 + 2] = data[i * 3 + 2];
+            image.pixels[i * 4 + 3] = 255;
+        }
+    }
+    return true;
+}
+
+CCLayerPanZoomAsyncTileProvider::CCLayerPanZoomAsyncTileProvider(PanZoomTileDecoder* decoder, int threadCount)
+    : _uploadsPerFrame(kCCLayerPanZoomDefaultTileUploadsPerFrame),
+      _loader(decoder, threadCount),
+      _uploadFrame(0),
+      _uploadCount(0)
+{
+}
+
+void CCLayerPanZoomAsyncTileProvider::prefetchTiles(const std::vector<PanZoomTileKey>& tiles){
+    _wanted.clear();
+    for (size_t i = 0; i < tiles.size(); ++i)
+    {
+        if (_failed.find(tiles[i]) == _failed.end() && _decoded.find(tiles[i]) == _decoded.end())
+        {
+            _wanted.push_back(tiles[i]);
+        }
+    }
+    _loader.setWanted(_wanted);
+
+    // Decoded tiles the layer no longer wants only take memory.
+    std::map<PanZoomTileKey, PanZoomTileImage>::iterator decoded = _decoded.begin();
+    while (decoded != _decoded.end())
+    {
+        if (std::find(tiles.begin(), tiles.end(), decoded->first) == tiles.end())
+        {
+            _decoded.erase(decoded++);
+        }
+        else
+        {
+            ++decoded;
+        }
+    }
+}
+
+void CCLayerPanZoomAsyncTileProvider::tilesReloaded(){
+    this->collectDecoded();
+    _decoded.clear();
+    _failed.clear();
+}
+
+CCNode* CCLayerPanZoomAsyncTileProvider::tileNode(const PanZoomTileKey& key){
+    this->collectDecoded();
+    std::map<PanZoomTileKey, PanZoomTileImage>::iterator decoded = _decoded.find(key);
+    if (decoded == _decoded.end())
+    {
+        return NULL;
+    }
+
+    const PanZoomTileImage& image = decoded->second;
+    if (image.pixels.empty() || image.pixels.size() < (size_t)image.width * image.height * 4)
+    {
+        CCLOG("CCLayerPanZoom: decoder returned no pixels for tile %d/%d_%d", key.level, key.x, key.y);
+        _failed.insert(key);
+        _decoded.erase(decoded);
+        return NULL;
+    }
+
+    unsigned int frame = CCDirector::sharedDirector()->getTotalFrames();
+    if (frame != _uploadFrame)
+    {
+        _uploadFrame = frame;
+        _uploadCount = 0;
+    }
+    if (_uploadCount >= _uploadsPerFrame)
+    {
+        return NULL;
+    }
+    ++_uploadCount;
+
+    CCTexture2D* texture = new CCTexture2D();
+    if (!texture->initWithData(&image.pixels[0], kCCTexture2DPixelFormat_RGBA8888, image.width, image.height, 
+        CCSizeMake((float)image.width, (float)image.height)))
+    {
+        CCLOG("CCLayerPanZoom: can't create the texture for tile %d/%d_%d", key.level, key.x, key.y);
+        texture->release();
+        _failed.insert(key);
+        _decoded.erase(decoded);
+        return NULL;
+    }
+    CCSprite* sprite = CCSprite::createWithTexture(texture);
+    texture->release();
+    _decoded.erase(decoded);
+    return sprite;
+}
+
+void CCLayerPanZoomAsyncTileProvider::collectDecoded(){
+    PanZoomTileKey key;
+    PanZoomTileImage image;
+    bool ok;
+    while (_loader.popDecoded(key, image, ok))
+    {
+        if (ok)
+        {
+            PanZoomTileImage& decoded = _decoded[key];
+            decoded.width = image.width;
+            decoded.height = image.height;
+            decoded.pixels.swap(image.pixels);
+        }
+        else
+        {
+            CCLOG("CCLayerPanZoom: failed to decode tile %d/%d_%d", key.level, key.x, key.y);
+            _failed.insert(key);
+        }
+    }
+}
@@ -0,0 +1,84 @@
+/*
+* CCLayerPanZoom
+*
+* Copyright (c) 2011 Alexey Lang
+* Copyright (c) 2011 Pavel Guganov
+*
+* http://www.cocos2d-x.org
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*
+*/
+
+
+#ifndef __CCLAYERPANZOOM_ASYNC_TILE_PROVIDER_H__
+#define __CCLAYERPANZOOM_ASYNC_TILE_PROVIDER_H__
+
+#include "CCLayerPanZoom.h"
+#include "PanZoomTileLoader.h"
+
+#include <string>
+
+#define kCCLayerPanZoomDefaultTileUploadsPerFrame 2
+
+// Decodes tiles from image files named by fileFormat (formatted with level, 
+// x and y, e.g. "%d/%d_%d.png") in directory.
+class CCLayerPanZoomFileTileDecoder : public PanZoomTileDecoder
+{
+public:
+    // Resolves directory, so it must be created on the main thread.
+    CCLayerPanZoomFileTileDecoder(const char* directory, const char* fileFormat);
+    virtual bool decode(const PanZoomTileKey& key, PanZoomTileImage& image);
+
+private:
+    std::string _directory;
+    std::string _fileFormat;
+};
+
+// Tile provider decoding tiles on worker threads. Only the texture upload 
+// happens on the GL thread, at most uploadsPerFrame tiles per frame, so 
+// flings over tiles that aren't loaded yet don't stall frames. Prefetched 
+// tiles are decoded in the order the layer wants them.
+class CCLayerPanZoomAsyncTileProvider : public CCLayerPanZoomTileProvider
+{
+public:
+    // The decoder isn't retained and must outlive the provider.
+    CCLayerPanZoomAsyncTileProvider(PanZoomTileDecoder* decoder, int threadCount);
+
+    virtual CCNode* tileNode(const PanZoomTileKey& key);
+    virtual void prefetchTiles(const std::vector<PanZoomTileKey>& tiles);
+    // Retries failed tiles and drops decoded ones not uploaded yet.
+    virtual void tilesReloaded();
+
+    CC_SYNTHESIZE(unsigned int, _uploadsPerFrame, UploadsPerFrame);
+
+private:
+    void collectDecoded();
+
+    PanZoomTileLoader _loader;
+    // Decoded tiles waiting for upload.
+    std::map<PanZoomTileKey, PanZoomTileImage> _decoded;
+    // Not requested again until the layer reloads its tiles.
+    std::set<PanZoomTileKey> _failed;
+    std::vector<PanZoomTileKey> _wanted;
+    unsigned int _uploadFrame;
+    unsigned int _uploadCount;
+};
+
+#endif // __CCLAYERPANZOOM_ASYNC_TILE_PROVIDER_H__
@@ -70,6 +70,9 @@ bool HelloWorld::init()
 
     // add the sprite as a child to this layer
     this->addChild(pSprite, 0);
+
+    // keep scrolling after the finger lifts
+    this->setflingEnabled(true);
     
     return true;
 }
@@ -0,0 +1,442 @@
+/*
+* CCLayerPanZoom
+*
+* Copyright (c) 2011 Alexey Lang
+* Copyright (c) 2011 Pavel Guganov
+*
+* http://www.cocos2d-x.org
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*
+*/
+
+
+#include "PanZoomBenchmark.h"
+
+#include <algorithm>
+
+#define kPanZoomBenchmarkFrameTime (1.0f / 60.0f)
+
+
+static double PanZoomBenchmarkNanoseconds()
+{
+    return PanZoomMonotonicTime() * 1.0e9;
+}
+
+static void PanZoomTraceAdd(PanZoomTouchTrace& trace, PanZoomTouchPhase phase, int touchId, 
+    float x, float y, bool lastInBatch)
+{
+    PanZoomTouchEvent event;
+    event.phase = phase;
+    event.touchId = touchId;
+    event.position = PanZoomPointMake(x, y);
+    event.dt = 0.0f;
+    event.time = trace.empty() ? 0.0 : trace.back().time;
+    event.lastInBatch = lastInBatch;
+    trace.push_back(event);
+}
+
+static void PanZoomTraceAddFrame(PanZoomTouchTrace& trace)
+{
+    PanZoomTouchEvent event;
+    event.phase = kPanZoomTouchFrame;
+    event.touchId = -1;
+    event.position = PanZoomPointMake(0.0f, 0.0f);
+    event.dt = kPanZoomBenchmarkFrameTime;
+    event.time = (trace.empty() ? 0.0 : trace.back().time) + event.dt;
+    event.lastInBatch = true;
+    trace.push_back(event);
+}
+
+void PanZoomTraceOneFingerPan(PanZoomTouchTrace& trace, unsigned int frames)
+{
+    // Swipes back and forth across the screen, two move events per frame.
+    float x = 240.0f;
+    float y = 160.0f;
+    PanZoomTraceAdd(trace, kPanZoomTouchBegan, 0, x, y, true);
+    for (unsigned int frame = 0; frame < frames; ++frame)
+    {
+        float direction = (frame / 60) % 2 ? -1.0f : 1.0f;
+        for (int i = 0; i < 2; ++i)
+        {
+            x += direction * 3.0f;
+            y += direction * 1.5f;
+            PanZoomTraceAdd(trace, kPanZoomTouchMoved, 0, x, y, true);
+        }
+        PanZoomTraceAddFrame(trace);
+    }
+    PanZoomTraceAdd(trace, kPanZoomTouchEnded, 0, x, y, true);
+    PanZoomTraceAddFrame(trace);
+}
+
+void PanZoomTraceTwoFingerPinch(PanZoomTouchTrace& trace, unsigned int frames)
+{
+    // Spreads and closes two fingers around a drifting center.
+    float centerX = 240.0f;
+    float centerY = 160.0f;
+    float spread = 60.0f;
+    PanZoomTraceAdd(trace, kPanZoomTouchBegan, 0, centerX - spread, centerY, false);
+    PanZoomTraceAdd(trace, kPanZoomTouchBegan, 1, centerX + spread, centerY, true);
+    for (unsigned int frame = 0; frame < frames; ++frame)
+    {
+        float direction = (frame / 45) % 2 ? -1.0f : 1.0f;
+        spread += direction * 2.0f;
+        centerX += direction * 0.5f;
+        centerY -= direction * 0.25f;
+        PanZoomTraceAdd(trace, kPanZoomTouchMoved, 0, centerX - spread, centerY, false);
+        PanZoomTraceAdd(trace, kPanZoomTouchMoved, 1, centerX + spread, centerY, true);
+        PanZoomTraceAddFrame(trace);
+    }
+    PanZoomTraceAdd(trace, kPanZoomTouchEnded, 0, centerX - spread, centerY, false);
+    PanZoomTraceAdd(trace, kPanZoomTouchEnded, 1, centerX + spread, centerY, true);
+    PanZoomTraceAddFrame(trace);
+}
+
+void PanZoomTraceMultiFingerPinch(PanZoomTouchTrace& trace, unsigned int frames)
+{
+    static const unsigned int fingers = 5;
+    static const int palmId = fingers;
+    float centerX = 240.0f;
+    float centerY = 160.0f;
+    float spread = 60.0f;
+    float angle = 0.0f;
+    for (unsigned int i = 0; i < fingers; ++i)
+    {
+        float fingerAngle = angle + i * 6.2831853f / fingers;
+        PanZoomTraceAdd(trace, kPanZoomTouchBegan, i, centerX + spread * cosf(fingerAngle), 
+            centerY + spread * sinf(fingerAngle), i == fingers - 1);
+    }
+    bool palmDown = false;
+    for (unsigned int frame = 0; frame < frames; ++frame)
+    {
+        float direction = (frame / 45) % 2 ? -1.0f : 1.0f;
+        spread += direction * 2.0f;
+        angle += direction * 0.01f;
+        centerX += direction * 0.5f;
+        if (frame % 60 == 30)
+        {
+            palmDown = !palmDown;
+            PanZoomTraceAdd(trace, palmDown ? kPanZoomTouchBegan : kPanZoomTouchEnded, palmId, 
+                centerX + 150.0f, centerY - 100.0f, true);
+        }
+        for (unsigned int i = 0; i < fingers; ++i)
+        {
+            float fingerAngle = angle + i * 6.2831853f / fingers;
+            PanZoomTraceAdd(trace, kPanZoomTouchMoved, i, centerX + spread * cosf(fingerAngle), 
+                centerY + spread * sinf(fingerAngle), i == fingers - 1 && !palmDown);
+        }
+        if (palmDown)
+        {
+            PanZoomTraceAdd(trace, kPanZoomTouchMoved, palmId, centerX + 150.0f, centerY - 100.0f, true);
+        }
+        PanZoomTraceAddFrame(trace);
+    }
+    if (palmDown)
+    {
+        PanZoomTraceAdd(trace, kPanZoomTouchEnded, palmId, centerX + 150.0f, centerY - 100.0f, false);
+    }
+    for (unsigned int i = 0; i < fingers; ++i)
+    {
+        float fingerAngle = angle + i * 6.2831853f / fingers;
+        PanZoomTraceAdd(trace, kPanZoomTouchEnded, i, centerX + spread * cosf(fingerAngle), 
+            centerY + spread * sinf(fingerAngle), i == fingers - 1);
+    }
+    PanZoomTraceAddFrame(trace);
+}
+
+void PanZoomTraceFrameEdgeHold(PanZoomTouchTrace& trace, unsigned int frames)
+{
+    // Drags far enough to rule out a click, then holds near the left edge.
+    float x = 400.0f;
+    float y = 160.0f;
+    PanZoomTraceAdd(trace, kPanZoomTouchBegan, 0, x, y, true);
+    while (x > 40.0f)
+    {
+        x -= 20.0f;
+        PanZoomTraceAdd(trace, kPanZoomTouchMoved, 0, x, y, true);
+        PanZoomTraceAddFrame(trace);
+    }
+    for (unsigned int frame = 0; frame < frames; ++frame)
+    {
+        // Small finger jitter while holding.
+        y += (frame % 2) ? 0.5f : -0.5f;
+        PanZoomTraceAdd(trace, kPanZoomTouchMoved, 0, x, y, true);
+        PanZoomTraceAddFrame(trace);
+    }
+    PanZoomTraceAdd(trace, kPanZoomTouchEnded, 0, x, y, true);
+    PanZoomTraceAddFrame(trace);
+}
+
+void PanZoomTraceBeginEndChurn(PanZoomTouchTrace& trace, unsigned int taps)
+{
+    // Rapid taps, every fourth one with a second finger.
+    for (unsigned int tap = 0; tap < taps; ++tap)
+    {
+        float x = 100.0f + (tap * 37) % 280;
+        float y = 60.0f + (tap * 23) % 200;
+        bool twoFingers = tap % 4 == 3;
+        PanZoomTraceAdd(trace, kPanZoomTouchBegan, 0, x, y, true);
+        if (twoFingers)
+        {
+            PanZoomTraceAdd(trace, kPanZoomTouchBegan, 1, x + 50.0f, y, true);
+        }
+        PanZoomTraceAdd(trace, kPanZoomTouchMoved, 0, x + 2.0f, y + 1.0f, !twoFingers);
+        if (twoFingers)
+        {
+            PanZoomTraceAdd(trace, kPanZoomTouchMoved, 1, x + 55.0f, y + 1.0f, true);
+        }
+        PanZoomTraceAddFrame(trace);
+        if (twoFingers)
+        {
+            PanZoomTraceAdd(trace, kPanZoomTouchEnded, 1, x + 55.0f, y + 1.0f, true);
+        }
+        PanZoomTraceAdd(trace, kPanZoomTouchEnded, 0, x + 2.0f, y + 1.0f, true);
+        PanZoomTraceAddFrame(trace);
+    }
+}
+
+void PanZoomTraceFling(PanZoomTouchTrace& trace, unsigned int frames)
+{
+    // Short fast swipe, then the layer coasts for the remaining frames.
+    float x = 400.0f;
+    float y = 100.0f;
+    PanZoomTraceAdd(trace, kPanZoomTouchBegan, 0, x, y, true);
+    for (int frame = 0; frame < 8; ++frame)
+    {
+        x -= 25.0f;
+        y += 10.0f;
+        PanZoomTraceAdd(trace, kPanZoomTouchMoved, 0, x, y, true);
+        PanZoomTraceAddFrame(trace);
+    }
+    PanZoomTraceAdd(trace, kPanZoomTouchEnded, 0, x, y, true);
+    for (unsigned int frame = 0; frame < frames; ++frame)
+    {
+        PanZoomTraceAddFrame(trace);
+    }
+}
+
+
+PanZoomControllerReplayTarget::PanZoomControllerReplayTarget()
+: _player(NULL)
+{
+    _staged.reserve(kPanZoomMaxTouches + 1);
+}
+
+PanZoomControllerReplayTarget::~PanZoomControllerReplayTarget()
+{
+    delete _player;
+}
+
+void PanZoomControllerReplayTarget::reset(const PanZoomController& prototype)
+{
+    delete _player;
+    _controller = prototype;
+    _player = new PanZoomTracePlayer(_controller);
+    _staged.clear();
+}
+
+void PanZoomControllerReplayTarget::stage(const PanZoomTouchEvent& event)
+{
+    _staged.push_back(event);
+}
+
+void PanZoomControllerReplayTarget::deliver()
+{
+    for (size_t i = 0; i < _staged.size(); ++i)
+    {
+        _player->play(_staged[i]);
+    }
+    _staged.clear();
+}
+
+
+PanZoomBenchmark::PanZoomBenchmark()
+: _allocationCounter(NULL)
+{
+    prototype.state.contentSize = PanZoomSizeMake(2048.0f, 2048.0f);
+    prototype.state.position = PanZoomPointMake(-784.0f, -864.0f);
+    prototype.state.panBoundsRect = PanZoomRectMake(0.0f, 0.0f, 480.0f, 320.0f);
+}
+
+void PanZoomBenchmark::setAllocationCounter(AllocationCounter allocationCounter)
+{
+    _allocationCounter = allocationCounter;
+}
+
+PanZoomBenchmarkResult PanZoomBenchmark::run(const char* name, const PanZoomTouchTrace& trace, 
+    unsigned int iterations)
+{
+    PanZoomControllerReplayTarget target;
+    return this->run(name, trace, iterations, target);
+}
+
+PanZoomBenchmarkResult PanZoomBenchmark::run(const char* name, const PanZoomTouchTrace& trace, 
+    unsigned int iterations, PanZoomReplayTarget& target)
+{
+    _samples.clear();
+    _samples.reserve(trace.size() * iterations);
+
+    double totalNs = 0.0;
+    unsigned long allocations = 0;
+    unsigned long touches = 0;
+
+    for (unsigned int iteration = 0; iteration < iterations; ++iteration)
+    {
+        // Gesture timing follows the trace, so replays are deterministic.
+        target.reset(prototype);
+
+        for (size_t i = 0; i < trace.size(); ++i)
+        {
+            const PanZoomTouchEvent& event = trace[i];
+            target.stage(event);
+            if (event.phase != kPanZoomTouchFrame)
+            {
+                ++touches;
+            }
+            if (!event.lastInBatch)
+            {
+                continue;
+            }
+            unsigned long allocationsBefore = _allocationCounter ? _allocationCounter() : 0;
+            double start = PanZoomBenchmarkNanoseconds();
+            target.deliver();
+            double batchNs = PanZoomBenchmarkNanoseconds() - start;
+            allocations += _allocationCounter ? _allocationCounter() - allocationsBefore : 0;
+            _samples.push_back(batchNs);
+            totalNs += batchNs;
+        }
+    }
+
+    PanZoomBenchmarkResult result;
+    result.name = name;
+    result.batches = (unsigned long)_samples.size();
+    result.touches = touches;
+    result.nsPerBatch = result.batches ? totalNs / result.batches : 0.0;
+    result.allocationsPerBatch = result.batches ? (double)allocations / result.batches : 0.0;
+    result.p50Ns = 0.0;
+    result.p99Ns = 0.0;
+    if (!_samples.empty())
+    {
+        size_t p50 = _samples.size() / 2;
+        size_t p99 = _samples.size() * 99 / 100;
+        std::nth_element(_samples.begin(), _samples.begin() + p50, _samples.end());
+        result.p50Ns = _samples[p50];
+        std::nth_element(_samples.begin(), _samples.begin() + p99, _samples.end());
+        result.p99Ns = _samples[p99];
+    }
+    return result;
+}
+
+void PanZoomBenchmark::runDefaultSuite(FILE* out, unsigned int iterations)
+{
+    PanZoomControllerReplayTarget target;
+    this->runDefaultSuite(out, iterations, target);
+}
+
+void PanZoomBenchmark::runDefaultSuite(FILE* out, unsigned int iterations, PanZoomReplayTarget& target)
+{
+    PanZoomController sheetPrototype = prototype;
+
+    PanZoomTouchTrace trace;
+    trace.reserve(4096);
+
+    PanZoomTraceOneFingerPan(trace, 600);
+    printResult(out, this->run("one-finger pan", trace, iterations, target));
+
+    prototype.state.rubberEffectRatio = 0.5f;
+    printResult(out, this->run("one-finger pan (rubber)", trace, iterations, target));
+    prototype = sheetPrototype;
+
+    prototype.coalesceTouches = true;
+    printResult(out, this->run("one-finger pan (coalesced)", trace, iterations, target));
+    prototype = sheetPrototype;
+
+    trace.clear();
+    PanZoomTraceTwoFingerPinch(trace, 600);
+    printResult(out, this->run("two-finger pinch", trace, iterations, target));
+
+    trace.clear();
+    PanZoomTraceMultiFingerPinch(trace, 600);
+    printResult(out, this->run("five-finger pinch + palm", trace, iterations, target));
+    prototype.rotationEnabled = true;
+    printResult(out, this->run("five-finger pinch (rotation)", trace, iterations, target));
+    prototype = sheetPrototype;
+
+    trace.clear();
+    PanZoomTraceFrameEdgeHold(trace, 600);
+    prototype.state.mode = kCCLayerPanZoomModeFrame;
+    printResult(out, this->run("frame mode edge hold", trace, iterations, target));
+    prototype = sheetPrototype;
+
+    trace.clear();
+    PanZoomTraceBeginEndChurn(trace, 500);
+    printResult(out, this->run("begin/end churn", trace, iterations, target));
+
+    trace.clear();
+    PanZoomTraceFling(trace, 180);
+    prototype.flingEnabled = true;
+    printResult(out, this->run("fling", trace, iterations, target));
+    prototype = sheetPrototype;
+}
+
+void PanZoomBenchmark::printResult(FILE* out, const PanZoomBenchmarkResult& result)
+{
+    fprintf(out, "%-28s %8lu batches %8lu touches %10.1f ns/batch %6.2f allocs/batch  p50 %8.1f ns  p99 %8.1f ns\n", 
+        result.name, result.batches, result.touches, result.nsPerBatch, result.allocationsPerBatch, 
+        result.p50Ns, result.p99Ns);
+}
+
+void PanZoomBenchmark::runConversions(FILE* out, unsigned int points, unsigned int iterations)
+{
+    PanZoomState state = prototype.state;
+    state.scale = 1.37f;
+    std::vector<float> xy(points * 2);
+    std::vector<float> converted(points * 2);
+    for (unsigned int i = 0; i < points; ++i)
+    {
+        xy[i * 2] = (float)(i % 640);
+        xy[i * 2 + 1] = (float)(i / 640);
+    }
+
+    // Fastest of the iterations, the loops are too short for percentiles.
+    double singleNs = 0.0;
+    double batchNs = 0.0;
+    for (unsigned int iteration = 0; iteration < iterations; ++iteration)
+    {
+        double start = PanZoomBenchmarkNanoseconds();
+        for (unsigned int i = 0; i < points; ++i)
+        {
+            PanZoomPoint point = state.convertToParentSpace(PanZoomPointMake(xy[i * 2], xy[i * 2 + 1]));
+            converted[i * 2] = point.x;
+            converted[i * 2 + 1] = point.y;
+        }
+        double ns = PanZoomBenchmarkNanoseconds() - start;
+        singleNs = iteration == 0 ? ns : std::min(singleNs, ns);
+
+        start = PanZoomBenchmarkNanoseconds();
+        state.convertToParentSpace(&xy[0], &converted[0], points);
+        ns = PanZoomBenchmarkNanoseconds() - start;
+        batchNs = iteration == 0 ? ns : std::min(batchNs, ns);
+    }
+
+    double perPoint = points ? 1.0 / points : 0.0;
+    fprintf(out, "%-28s %8u points %10.2f ns/point\n", "convert per point", points, singleNs * perPoint);
+    fprintf(out, "%-28s %8u points %10.2f ns/point  %.1fx\n", "convert batch", points, batchNs * perPoint, 
+        batchNs > 0.0 ? singleNs / batchNs : 0.0);
+}
@@ -0,0 +1,136 @@
+/*
+* CCLayerPanZoom
+*
+* Copyright (c) 2011 Alexey Lang
+* Copyright (c) 2011 Pavel Guganov
+*
+* http://www.cocos2d-x.org
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*
+*/
+
+
+#ifndef __PANZOOM_BENCHMARK_H__
+#define __PANZOOM_BENCHMARK_H__
+
+#include "PanZoomTrace.h"
+
+#include <stdio.h>
+#include <vector>
+
+// Headless touch replay benchmark for the CCLayerPanZoom gesture code.
+// By default traces are replayed with PanZoomTracePlayer through the same 
+// PanZoomController calls that CCLayerPanZoom::ccTouches* and 
+// CCLayerPanZoom::update make, so it runs on a host without cocos2d-x or a 
+// GL context. A PanZoomReplayTarget can deliver them elsewhere, e.g. to the
+// layer handlers themselves (proj.host/benchmark). Recorded traces 
+// (PanZoomTraceRecording::events) replay too.
+
+// Synthetic traces. Each frame is 1/60 s and the traces are appended to trace.
+void PanZoomTraceOneFingerPan(PanZoomTouchTrace& trace, unsigned int frames);
+void PanZoomTraceTwoFingerPinch(PanZoomTouchTrace& trace, unsigned int frames);
+// Five fingers pinching while a sixth (a resting palm) touches down and lifts.
+void PanZoomTraceMultiFingerPinch(PanZoomTouchTrace& trace, unsigned int frames);
+void PanZoomTraceFrameEdgeHold(PanZoomTouchTrace& trace, unsigned int frames);
+void PanZoomTraceBeginEndChurn(PanZoomTouchTrace& trace, unsigned int taps);
+void PanZoomTraceFling(PanZoomTouchTrace& trace, unsigned int frames);
+
+struct PanZoomBenchmarkResult
+{
+    const char* name;
+    // Handler invocations (touch batches and frames); the timings and
+    // allocations are per batch.
+    unsigned long batches;
+    // Touches delivered in those batches, frames not included.
+    unsigned long touches;
+    double nsPerBatch;
+    double allocationsPerBatch;
+    double p50Ns;
+    double p99Ns;
+};
+
+// Receives the replayed events. The events of a touch batch (or a frame) are
+// staged one by one, then delivered at once; only deliver() is timed and 
+// counted for allocations.
+class PanZoomReplayTarget
+{
+public:
+    virtual ~PanZoomReplayTarget() {}
+    // Starts a replay from the state and settings of prototype.
+    virtual void reset(const PanZoomController& prototype) = 0;
+    virtual void stage(const PanZoomTouchEvent& event) = 0;
+    // Runs the handler of the staged batch.
+    virtual void deliver() = 0;
+};
+
+// Replays through a copy of the prototype controller with PanZoomTracePlayer.
+class PanZoomControllerReplayTarget : public PanZoomReplayTarget
+{
+public:
+    PanZoomControllerReplayTarget();
+    virtual ~PanZoomControllerReplayTarget();
+
+    virtual void reset(const PanZoomController& prototype);
+    virtual void stage(const PanZoomTouchEvent& event);
+    virtual void deliver();
+
+private:
+    PanZoomController _controller;
+    PanZoomTracePlayer* _player;
+    PanZoomTouchTrace _staged;
+};
+
+class PanZoomBenchmark
+{
+public:
+    // Returns the number of heap allocations made so far, e.g. counted by a
+    // replaced operator new in the host program.
+    typedef unsigned long (*AllocationCounter)();
+
+    PanZoomBenchmark();
+
+    // Controller every replay starts from.
+    PanZoomController prototype;
+
+    void setAllocationCounter(AllocationCounter allocationCounter);
+
+    // Replays trace iterations times, each time from prototype, through the
+    // controller or target.
+    PanZoomBenchmarkResult run(const char* name, const PanZoomTouchTrace& trace, 
+        unsigned int iterations);
+    PanZoomBenchmarkResult run(const char* name, const PanZoomTouchTrace& trace, 
+        unsigned int iterations, PanZoomReplayTarget& target);
+
+    // Runs the synthetic traces above and prints the results.
+    void runDefaultSuite(FILE* out, unsigned int iterations);
+    void runDefaultSuite(FILE* out, unsigned int iterations, PanZoomReplayTarget& target);
+
+    static void printResult(FILE* out, const PanZoomBenchmarkResult& result);
+
+    // Times the batch PanZoomState conversions of points against one 
+    // single point conversion per point and prints both.
+    void runConversions(FILE* out, unsigned int points, unsigned int iterations);
+
+private:
+    AllocationCounter _allocationCounter;
+    std::vector<double> _samples;
+};
+
+#endif // __PANZOOM_BENCHMARK_H__
@@ -0,0 +1,69 @@
+/*
+* CCLayerPanZoom
+*
+* Copyright (c) 2011 Alexey Lang
+* Copyright (c) 2011 Pavel Guganov
+*
+* http://www.cocos2d-x.org
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*
+*/
+
+
+#ifndef __PANZOOM_CLOCK_H__
+#define __PANZOOM_CLOCK_H__
+
+// Monotonic time in seconds since an unspecified start, unaffected by wall 
+// clock changes.
+double PanZoomMonotonicTime();
+
+// Time source for gesture timing. PanZoomController uses the system clock by
+// default; tests and trace replay inject a PanZoomManualClock.
+class PanZoomClock
+{
+public:
+    virtual ~PanZoomClock() {}
+    // Current time in seconds.
+    virtual double now() const = 0;
+};
+
+class PanZoomSystemClock : public PanZoomClock
+{
+public:
+    virtual double now() const;
+
+    // Shared instance used by default.
+    static PanZoomSystemClock* sharedClock();
+};
+
+class PanZoomManualClock : public PanZoomClock
+{
+public:
+    PanZoomManualClock() : _time(0.0) {}
+
+    virtual double now() const { return _time; }
+    void setTime(double time) { _time = time; }
+    void advance(double seconds) { _time += seconds; }
+
+private:
+    double _time;
+};
+
+#endif // __PANZOOM_CLOCK_H__
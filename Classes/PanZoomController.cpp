@@ -0,0 +1,865 @@
+/*
+* CCLayerPanZoom
+*
+* Copyright (c) 2011 Alexey Lang
+* Copyright (c) 2011 Pavel Guganov
+*
+* http://www.cocos2d-x.org
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*
+*/
+
+
+#include "PanZoomController.h"
+
+#include <stddef.h>
+
+#ifndef MIN
+#define MIN(x,y) (((x) > (y)) ? (y) : (x))
+#endif
+#ifndef MAX
+#define MAX(x,y) (((x) < (y)) ? (y) : (x))
+#endif
+
+
+static float PanZoomDistance(PanZoomPoint a, PanZoomPoint b)
+{
+    return sqrtf((a.x - b.x) * (a.x - b.x) + (a.y - b.y) * (a.y - b.y));
+}
+
+static PanZoomPoint PanZoomMidpoint(PanZoomPoint a, PanZoomPoint b)
+{
+    return PanZoomPointMake((a.x + b.x) * 0.5f, (a.y + b.y) * 0.5f);
+}
+
+
+PanZoomController::PanZoomController()
+: touchCount(0)
+, maxTouchDistanceToClick(315.0f)
+, touchDistance(0.0f)
+, coalesceTouches(false)
+, rotationEnabled(false)
+, rotation(0.0f)
+, singleTouchTimestamp(INFINITY)
+, touchMoveBegan(false)
+, prevSingleTouchPositionInLayer(PanZoomPointMake(0.0f, 0.0f))
+, rubberEffectRecovering(false)
+, rubberEffectRecoveryTime(0.2f)
+, clock(PanZoomSystemClock::sharedClock())
+, flingEnabled(false)
+, flingFriction(4.0f)
+, flingMinVelocity(20.0f)
+, flinging(false)
+, flingVelocity(PanZoomPointMake(0.0f, 0.0f))
+, predictionTime(0.0f)
+, predictionOffset(PanZoomPointMake(0.0f, 0.0f))
+, animating(false)
+, velocitySampleCount(0)
+, velocitySampleHead(0)
+, _flingAccumulator(0.0)
+, _touchesMovedPending(false)
+, _touchMoveBeganPending(false)
+, _predictionSampleCount(0)
+{
+    recoveryX.target = recoveryY.target = recoveryScale.target = 0.0f;
+    recoveryX.velocity = recoveryY.velocity = recoveryScale.velocity = 0.0f;
+
+    frameSettings.topMargin = 100.0f;
+    frameSettings.bottomMargin = 100.0f;
+    frameSettings.leftMargin = 100.0f;
+    frameSettings.rightMargin = 100.0f;
+    frameSettings.minSpeed = 100.0f;
+    frameSettings.maxSpeed = 1000.0f;
+    frameSettings.speedCurve = kCCLayerPanZoomEdgeSpeedCurveLinear;
+    for (unsigned int i = 0; i <= kPanZoomEdgeSpeedTableSegments; ++i)
+    {
+        frameSettings.customSpeedCurve[i] = (float)i / kPanZoomEdgeSpeedTableSegments;
+    }
+    frameSettings.precompute();
+}
+
+void PanZoomController::setPosition(PanZoomPoint position)
+{
+    CC_PANZOOM_STATS_COUNT(stats, kPanZoomStatClamps, 1);
+    state.position = state.constrainedPosition(state.position, position, rubberEffectRecovering);
+}
+
+void PanZoomController::setScale(float scale)
+{
+    state.scale = state.clampScale(scale);
+}
+
+void PanZoomController::addTouch(int touchId, PanZoomPoint position)
+{
+    this->flushTouches();
+    if (touchCount == kPanZoomMaxTouches || this->touchWithId(touchId))
+    {
+        return;
+    }
+    PanZoomTouch& touch = touches[touchCount++];
+    touch.touchId = touchId;
+    touch.position = position;
+    touch.previousPosition = position;
+}
+
+void PanZoomController::moveTouch(int touchId, PanZoomPoint position)
+{
+    // previousPosition keeps the base of the next gesture step.
+    PanZoomTouch* touch = this->touchWithId(touchId);
+    if (touch)
+    {
+        // Accumulate touch distance for all modes, move by move so that 
+        // coalescing doesn't shorten the path.
+        if (touchCount == 1)
+        {
+            touchDistance += PanZoomDistance(position, touch->position);
+        }
+        touch->position = position;
+    }
+}
+
+void PanZoomController::removeTouch(int touchId)
+{
+    this->flushTouches();
+    for (unsigned int i = 0; i < touchCount; ++i)
+    {
+        if (touches[i].touchId == touchId)
+        {
+            // Keep the order, the first touch drives single touch gestures.
+            for (unsigned int j = i + 1; j < touchCount; ++j)
+            {
+                touches[j - 1] = touches[j];
+            }
+            --touchCount;
+            return;
+        }
+    }
+}
+
+PanZoomTouch* PanZoomController::touchWithId(int touchId)
+{
+    for (unsigned int i = 0; i < touchCount; ++i)
+    {
+        if (touches[i].touchId == touchId)
+        {
+            return &touches[i];
+        }
+    }
+    return NULL;
+}
+
+void PanZoomController::touchesBegan()
+{
+    // Touching the layer catches a fling and interrupts recovery and 
+    // animations.
+    this->stopFling();
+    this->stopAnimation();
+    rubberEffectRecovering = false;
+    velocitySampleCount = 0;
+    _predictionSampleCount = 0;
+    predictionOffset = PanZoomPointMake(0.0f, 0.0f);
+
+    if (touchCount == 1)
+    {
+        touchMoveBegan = false;
+        singleTouchTimestamp = clock->now();
+    }
+    else
+        singleTouchTimestamp = INFINITY;
+}
+
+bool PanZoomController::touchesMoved()
+{
+    if (coalesceTouches)
+    {
+        _touchesMovedPending = true;
+        return false;
+    }
+    return this->stepTouches();
+}
+
+void PanZoomController::flushTouches()
+{
+    if (_touchesMovedPending && this->stepTouches())
+    {
+        _touchMoveBeganPending = true;
+    }
+}
+
+bool PanZoomController::hasPendingTouchMoves() const
+{
+    return _touchesMovedPending;
+}
+
+bool PanZoomController::stepTouches()
+{
+    _touchesMovedPending = false;
+    bool touchMoveBegan = false;
+    if (touchCount > 1)
+    {
+        // Both groups are measured over the same touches, so fingers joining
+        // or leaving the gesture move neither the centroid nor the scale.
+        PanZoomTouchGroup prevGroup = this->touchGroup(true);
+        PanZoomTouchGroup curGroup = this->touchGroup(false);
+        if (rotationEnabled)
+        {
+            rotation += this->touchRotation(prevGroup, curGroup);
+        }
+        this->pinch(prevGroup, curGroup);
+    }
+    else if (touchCount == 1)
+    {
+        touchMoveBegan = this->pan(touches[0].previousPosition, touches[0].position);
+    }
+    this->rebaseTouches();
+    this->updatePrediction();
+    return touchMoveBegan;
+}
+
+PanZoomTouchGroup PanZoomController::touchGroup(bool previous) const
+{
+    PanZoomTouchGroup group;
+    group.centroid = PanZoomPointMake(0.0f, 0.0f);
+    group.spread = 0.0f;
+    if (!touchCount)
+    {
+        return group;
+    }
+
+    float sumX = 0.0f, sumY = 0.0f;
+    for (unsigned int i = 0; i < touchCount; ++i)
+    {
+        PanZoomPoint position = previous ? touches[i].previousPosition : touches[i].position;
+        sumX += position.x;
+        sumY += position.y;
+    }
+    float inverseCount = 1.0f / touchCount;
+    group.centroid = PanZoomPointMake(sumX * inverseCount, sumY * inverseCount);
+
+    // Mean squared distance from the centroid, one square root per group.
+    float variance = 0.0f;
+    for (unsigned int i = 0; i < touchCount; ++i)
+    {
+        PanZoomPoint position = previous ? touches[i].previousPosition : touches[i].position;
+        float dx = position.x - group.centroid.x;
+        float dy = position.y - group.centroid.y;
+        variance += dx * dx + dy * dy;
+    }
+    group.spread = sqrtf(variance * inverseCount);
+    return group;
+}
+
+float PanZoomController::touchRotation(const PanZoomTouchGroup& prevGroup, 
+    const PanZoomTouchGroup& curGroup) const
+{
+    // Angle of the summed per touch rotations, weighted by distance from 
+    // the centroid so fingers near it don't add noise.
+    float cross = 0.0f, dot = 0.0f;
+    for (unsigned int i = 0; i < touchCount; ++i)
+    {
+        float prevX = touches[i].previousPosition.x - prevGroup.centroid.x;
+        float prevY = touches[i].previousPosition.y - prevGroup.centroid.y;
+        float curX = touches[i].position.x - curGroup.centroid.x;
+        float curY = touches[i].position.y - curGroup.centroid.y;
+        cross += prevX * curY - prevY * curX;
+        dot += prevX * curX + prevY * curY;
+    }
+    if (!cross)
+    {
+        return 0.0f;
+    }
+    // Counterclockwise in GL space is negative CCNode rotation.
+    return -atan2f(cross, dot) * 57.29577951f;
+}
+
+void PanZoomController::rebaseTouches()
+{
+    for (unsigned int i = 0; i < touchCount; ++i)
+    {
+        touches[i].previousPosition = touches[i].position;
+    }
+}
+
+bool PanZoomController::isClickPossible() const
+{
+    return touchDistance < maxTouchDistanceToClick && touchCount == 1;
+}
+
+void PanZoomController::touchesEnded()
+{
+    singleTouchTimestamp = INFINITY;
+
+    if (touchCount == 0)
+    {
+        // Throw the layer if the finger was moving when it lifted.
+        if (flingEnabled && state.mode == kCCLayerPanZoomModeSheet)
+        {
+            PanZoomPoint velocity = this->touchVelocity();
+            if (velocity.x * velocity.x + velocity.y * velocity.y > flingMinVelocity * flingMinVelocity)
+            {
+                flinging = true;
+                flingVelocity = velocity;
+                _flingAccumulator = 0.0;
+                // The fling goes on from where the layer was shown.
+                if (predictionOffset.x || predictionOffset.y)
+                {
+                    this->setPosition(PanZoomPointMake(state.position.x + predictionOffset.x, 
+                        state.position.y + predictionOffset.y));
+                }
+            }
+        }
+        velocitySampleCount = 0;
+        touchDistance = 0.0f;
+        rotation = 0.0f;
+    }
+
+    // Recovery is postponed until the end of a fling.
+    if (!touchCount && !flinging)
+    {
+        this->recoverPositionAndScale();
+    }
+    this->updatePrediction();
+}
+
+void PanZoomController::touchesCancelled()
+{
+    if (touchCount == 0)
+    {
+        touchDistance = 0.0f;
+        rotation = 0.0f;
+    }
+    this->updatePrediction();
+}
+
+void PanZoomController::pinch(PanZoomPoint prevPosTouch1, PanZoomPoint prevPosTouch2, 
+    PanZoomPoint curPosTouch1, PanZoomPoint curPosTouch2)
+{
+    PanZoomTouchGroup prevGroup, curGroup;
+    prevGroup.centroid = PanZoomMidpoint(prevPosTouch1, prevPosTouch2);
+    prevGroup.spread = PanZoomDistance(prevPosTouch1, prevPosTouch2) * 0.5f;
+    curGroup.centroid = PanZoomMidpoint(curPosTouch1, curPosTouch2);
+    curGroup.spread = PanZoomDistance(curPosTouch1, curPosTouch2) * 0.5f;
+    this->pinch(prevGroup, curGroup);
+}
+
+void PanZoomController::pinch(const PanZoomTouchGroup& prevGroup, const PanZoomTouchGroup& curGroup)
+{
+    // Calculate current and previous positions of the layer relative the anchor point
+    PanZoomPoint curPosLayer = curGroup.centroid;
+    PanZoomPoint prevPosLayer = prevGroup.centroid;
+
+    // Calculate new scale, coinciding fingers only pan.
+    float prevScale = state.scale;
+    float curScale = state.scale;
+    if (prevGroup.spread > 0.0f)
+    {
+        curScale = state.scale * curGroup.spread / prevGroup.spread;
+    }
+
+    curScale = state.clampScale(curScale);
+    // Avoid scaling out from panBoundsRect when Rubber Effect is OFF.
+    if (!state.rubberEffectRatio)
+    {
+        curScale = state.clampScale(MAX(curScale, state.minPossibleScale())); 
+    }
+
+    // Compute the final position of this step and clamp it once.
+    bool scaleChanged = curScale != prevScale;
+    bool centerMoved = !PanZoomPointEqual(prevPosLayer, curPosLayer);
+    if (scaleChanged || centerMoved)
+    {
+        state.scale = curScale;
+
+        // If scale was changed -> fix position with new scale. This part is
+        // never slowed down by the rubber effect.
+        PanZoomPoint zoomedPosition = state.position;
+        if (scaleChanged)
+        {
+            PanZoomPoint realCurPosLayer = state.convertToNodeSpace(curPosLayer);
+            zoomedPosition.x -= (realCurPosLayer.x - state.anchorPoint.x * state.contentSize.width) * (curScale - prevScale);
+            zoomedPosition.y -= (realCurPosLayer.y - state.anchorPoint.y * state.contentSize.height) * (curScale - prevScale);
+        }
+
+        // Move by the multitouch's center offset.
+        PanZoomPoint position = PanZoomPointMake(zoomedPosition.x + curPosLayer.x - prevPosLayer.x,
+            zoomedPosition.y + curPosLayer.y - prevPosLayer.y);
+        CC_PANZOOM_STATS_COUNT(stats, kPanZoomStatClamps, 1);
+        state.position = state.constrainedPosition(zoomedPosition, position, rubberEffectRecovering);
+    }
+    // Pinches don't fling.
+    velocitySampleCount = 0;
+
+    // Don't click with multitouch
+    touchDistance = INFINITY;
+}
+
+bool PanZoomController::pan(PanZoomPoint prevTouchPosition, PanZoomPoint curTouchPosition)
+{
+    // Always scroll in sheet mode.
+    if (state.mode == kCCLayerPanZoomModeSheet)
+    {
+        // Set new position of the layer.
+        this->setPosition(PanZoomPointMake(state.position.x + curTouchPosition.x - prevTouchPosition.x,
+            state.position.y + curTouchPosition.y - prevTouchPosition.y));
+    }
+
+    if (state.mode == kCCLayerPanZoomModeSheet)
+    {
+        this->addVelocitySample(PanZoomPointMake(curTouchPosition.x - prevTouchPosition.x, 
+            curTouchPosition.y - prevTouchPosition.y));
+        this->addPredictionSample(curTouchPosition);
+    }
+
+    // Inform delegate about starting updating touch position, if click isn't possible.
+    if (state.mode == kCCLayerPanZoomModeFrame)
+    {
+        if (touchDistance > maxTouchDistanceToClick && !touchMoveBegan)
+        {
+            touchMoveBegan = true;
+            return true;
+        }
+    }
+    return false;
+}
+
+unsigned int PanZoomController::update(float dt)
+{
+    unsigned int events = kPanZoomUpdateNone;
+
+    this->flushTouches();
+    if (_touchMoveBeganPending)
+    {
+        _touchMoveBeganPending = false;
+        events |= kPanZoomUpdateTouchMoveBegan;
+    }
+
+    if (flinging)
+    {
+        // Fixed time step keeps the fling independent of the frame rate.
+        _flingAccumulator += MIN(dt, 0.25f);
+        while (_flingAccumulator >= kPanZoomFlingTimeStep)
+        {
+            _flingAccumulator -= kPanZoomFlingTimeStep;
+            if (this->stepFling(kPanZoomFlingTimeStep))
+            {
+                events |= kPanZoomUpdateFlingEnded;
+                // Pull the layer back if the fling ended out of bounds.
+                this->recoverPositionAndScale();
+                break;
+            }
+        }
+    }
+
+    if (rubberEffectRecovering && this->stepRecovery(dt))
+    {
+        events |= kPanZoomUpdateRecoveryEnded;
+    }
+
+    if (animating && this->stepAnimation(dt))
+    {
+        events |= kPanZoomUpdateAnimationEnded;
+    }
+
+    if (this->updateFrameMode(dt))
+    {
+        events |= kPanZoomUpdateTouchPositionChanged;
+    }
+    this->updatePrediction();
+    return events;
+}
+
+bool PanZoomController::needsUpdate() const
+{
+    return flinging || rubberEffectRecovering || animating || _touchesMovedPending || _touchMoveBeganPending ||
+        (state.mode == kCCLayerPanZoomModeFrame && touchCount == 1) || 
+        predictionOffset.x || predictionOffset.y;
+}
+
+void PanZoomController::stopFling()
+{
+    flinging = false;
+    flingVelocity = PanZoomPointMake(0.0f, 0.0f);
+    _flingAccumulator = 0.0;
+}
+
+void PanZoomController::animateTo(PanZoomPoint nodePoint, PanZoomPoint parentPoint, float scale, 
+    float duration, CCLayerPanZoomEasing easing)
+{
+    this->stopFling();
+    this->stopRecovery();
+
+    // Resolve the target once: limited scale, and the position nearest the
+    // requested one that covers the bounds.
+    PanZoomPoint startPosition = state.position;
+    float startScale = state.scale;
+    _animationStartCenter = state.convertToNodeSpace(parentPoint);
+
+    state.scale = state.clampScale(state.hasPanBounds() ? MAX(scale, state.minPossibleScale()) : scale);
+    state.position = state.positionForPoint(nodePoint, parentPoint);
+    if (state.hasPanBounds())
+    {
+        state.position = state.boundedPosition(state.position);
+    }
+    _animationEndCenter = state.convertToNodeSpace(parentPoint);
+    _animationEndScale = state.scale;
+
+    state.position = startPosition;
+    state.scale = startScale;
+    _animationStartScale = startScale;
+    _animationAnchor = parentPoint;
+    _animationTime = 0.0f;
+    _animationDuration = duration;
+    _animationEasing = easing;
+    animating = true;
+
+    // Without duration the layer jumps right away.
+    if (duration <= 0.0f)
+    {
+        this->stepAnimation(0.0f);
+    }
+}
+
+void PanZoomController::animateToRect(const PanZoomRect& rect, const PanZoomRect& viewport, 
+    float duration, CCLayerPanZoomEasing easing)
+{
+    float scale = state.maxScale;
+    if (rect.size.width > 0.0f && rect.size.height > 0.0f)
+    {
+        scale = MIN(viewport.size.width / rect.size.width, viewport.size.height / rect.size.height);
+    }
+    this->animateTo(PanZoomPointMake(rect.origin.x + rect.size.width * 0.5f, rect.origin.y + rect.size.height * 0.5f),
+        PanZoomPointMake(viewport.origin.x + viewport.size.width * 0.5f, viewport.origin.y + viewport.size.height * 0.5f),
+        scale, duration, easing);
+}
+
+void PanZoomController::stopAnimation()
+{
+    animating = false;
+}
+
+static float PanZoomEase(CCLayerPanZoomEasing easing, float t)
+{
+    switch (easing)
+    {
+    case kCCLayerPanZoomEasingEaseIn:
+        return t * t * t;
+    case kCCLayerPanZoomEasingEaseOut:
+        return 1.0f - (1.0f - t) * (1.0f - t) * (1.0f - t);
+    case kCCLayerPanZoomEasingEaseInOut:
+        return t < 0.5f ? 4.0f * t * t * t : 1.0f - 4.0f * (1.0f - t) * (1.0f - t) * (1.0f - t);
+    default:
+        return t;
+    }
+}
+
+bool PanZoomController::stepAnimation(float dt)
+{
+    _animationTime += dt;
+    float t = _animationDuration > 0.0f ? MIN(_animationTime / _animationDuration, 1.0f) : 1.0f;
+    float e = t < 1.0f ? PanZoomEase(_animationEasing, t) : 1.0f;
+
+    // Geometric scale steps look uniform while zooming.
+    state.scale = t < 1.0f ? _animationStartScale * powf(_animationEndScale / _animationStartScale, e) : 
+        _animationEndScale;
+    PanZoomPoint center = PanZoomPointMake(
+        _animationStartCenter.x + (_animationEndCenter.x - _animationStartCenter.x) * e,
+        _animationStartCenter.y + (_animationEndCenter.y - _animationStartCenter.y) * e);
+    PanZoomPoint position = state.positionForPoint(center, _animationAnchor);
+    if (state.hasPanBounds())
+    {
+        CC_PANZOOM_STATS_COUNT(stats, kPanZoomStatClamps, 1);
+        position = state.boundedPosition(position);
+    }
+    state.position = position;
+
+    if (t >= 1.0f)
+    {
+        animating = false;
+        return true;
+    }
+    return false;
+}
+
+void PanZoomController::recoverPositionAndScale()
+{
+    if (!state.hasPanBounds())
+    {
+        return;
+    }
+
+    PanZoomEdgeDistances edges = state.edgeDistances();
+    if (!edges.right && !edges.left && !edges.top && !edges.bottom)
+    {
+        return;
+    }
+
+    // Smallest scale that covers the bounds, and the nearest position that
+    // covers them at that scale.
+    float scale = MAX(state.scale, state.minPossibleScale());
+    PanZoomPositionLimits limits = PanZoomState::positionLimits(state.panBoundsRect, 
+        PanZoomSizeMake(state.contentSize.width * scale, state.contentSize.height * scale), 
+        state.anchorPoint);
+    PanZoomPoint position = PanZoomState::clampPosition(state.position, limits);
+
+    if (!rubberEffectRecovering)
+    {
+        CC_PANZOOM_STATS_COUNT(stats, kPanZoomStatRecoveriesStarted, 1);
+        recoveryX.velocity = recoveryY.velocity = recoveryScale.velocity = 0.0f;
+    }
+    recoveryX.target = position.x;
+    recoveryY.target = position.y;
+    recoveryScale.target = scale;
+    rubberEffectRecovering = true;
+}
+
+void PanZoomController::stopRecovery()
+{
+    rubberEffectRecovering = false;
+    recoveryX.velocity = recoveryY.velocity = recoveryScale.velocity = 0.0f;
+}
+
+// Advances a critically damped spring in closed form, stable for any dt.
+static float PanZoomSpringStep(PanZoomSpring& spring, float value, float omega, float dt)
+{
+    float offset = value - spring.target;
+    float temp = (spring.velocity + omega * offset) * dt;
+    float decay = expf(-omega * dt);
+    spring.velocity = (spring.velocity - omega * temp) * decay;
+    return spring.target + (offset + temp) * decay;
+}
+
+bool PanZoomController::stepRecovery(float dt)
+{
+    // Settles to ~2% of the distance in rubberEffectRecoveryTime.
+    float omega = 6.0f / MAX(rubberEffectRecoveryTime, 0.01f);
+
+    state.position.x = PanZoomSpringStep(recoveryX, state.position.x, omega, dt);
+    state.position.y = PanZoomSpringStep(recoveryY, state.position.y, omega, dt);
+    state.scale = PanZoomSpringStep(recoveryScale, state.scale, omega, dt);
+
+    if (fabsf(state.position.x - recoveryX.target) < 0.5f && 
+        fabsf(state.position.y - recoveryY.target) < 0.5f && 
+        fabsf(state.scale - recoveryScale.target) < 0.001f &&
+        fabsf(recoveryX.velocity) < 1.0f && fabsf(recoveryY.velocity) < 1.0f &&
+        fabsf(recoveryScale.velocity) < 0.002f)
+    {
+        state.position = PanZoomPointMake(recoveryX.target, recoveryY.target);
+        state.scale = recoveryScale.target;
+        this->stopRecovery();
+        return true;
+    }
+    return false;
+}
+
+void PanZoomController::addVelocitySample(PanZoomPoint delta)
+{
+    PanZoomVelocitySample& sample = velocitySamples[velocitySampleHead];
+    sample.delta = delta;
+    sample.time = clock->now();
+    velocitySampleHead = (velocitySampleHead + 1) % kPanZoomVelocitySamples;
+    if (velocitySampleCount < kPanZoomVelocitySamples)
+    {
+        ++velocitySampleCount;
+    }
+}
+
+PanZoomPoint PanZoomController::touchVelocity() const
+{
+    PanZoomPoint distance = PanZoomPointMake(0.0f, 0.0f);
+    double now = clock->now();
+    double oldest = now;
+    for (unsigned int i = 0; i < velocitySampleCount; ++i)
+    {
+        unsigned int index = (velocitySampleHead + kPanZoomVelocitySamples - 1 - i) % kPanZoomVelocitySamples;
+        const PanZoomVelocitySample& sample = velocitySamples[index];
+        if (now - sample.time > kPanZoomVelocityWindow)
+        {
+            break;
+        }
+        distance.x += sample.delta.x;
+        distance.y += sample.delta.y;
+        oldest = sample.time;
+    }
+
+    // Moves of one frame may share a timestamp, so the span covers at least one frame.
+    float span = (float)MAX(now - oldest, 1.0 / 60.0);
+    return PanZoomPointMake(distance.x / span, distance.y / span);
+}
+
+void PanZoomController::addPredictionSample(PanZoomPoint position)
+{
+    double now = clock->now();
+    // Moves delivered together share a timestamp, keep the latest.
+    if (_predictionSampleCount && _predictionTimes[_predictionSampleCount - 1] == now)
+    {
+        _predictionPositions[_predictionSampleCount - 1] = position;
+        return;
+    }
+    if (_predictionSampleCount == 3)
+    {
+        _predictionPositions[0] = _predictionPositions[1];
+        _predictionPositions[1] = _predictionPositions[2];
+        _predictionTimes[0] = _predictionTimes[1];
+        _predictionTimes[1] = _predictionTimes[2];
+        --_predictionSampleCount;
+    }
+    _predictionPositions[_predictionSampleCount] = position;
+    _predictionTimes[_predictionSampleCount] = now;
+    ++_predictionSampleCount;
+}
+
+void PanZoomController::updatePrediction()
+{
+    predictionOffset = PanZoomPointMake(0.0f, 0.0f);
+    if (predictionTime <= 0.0f || state.mode != kCCLayerPanZoomModeSheet || touchCount != 1 || 
+        _predictionSampleCount < 3 || rubberEffectRecovering)
+    {
+        return;
+    }
+
+    // Stop predicting as soon as the finger rests.
+    if (clock->now() - _predictionTimes[2] > kPanZoomPredictionStaleTime)
+    {
+        return;
+    }
+
+    float dt0 = (float)(_predictionTimes[1] - _predictionTimes[0]);
+    float dt1 = (float)(_predictionTimes[2] - _predictionTimes[1]);
+    if (dt0 <= 0.0f || dt1 <= 0.0f)
+    {
+        return;
+    }
+    PanZoomPoint v0 = PanZoomPointMake((_predictionPositions[1].x - _predictionPositions[0].x) / dt0,
+        (_predictionPositions[1].y - _predictionPositions[0].y) / dt0);
+    PanZoomPoint v1 = PanZoomPointMake((_predictionPositions[2].x - _predictionPositions[1].x) / dt1,
+        (_predictionPositions[2].y - _predictionPositions[1].y) / dt1);
+
+    // A reversing finger would be overshot.
+    if (v0.x * v1.x + v0.y * v1.y <= 0.0f)
+    {
+        return;
+    }
+
+    float t = predictionTime;
+    float accelerationFactor = 0.5f * t * t / (0.5f * (dt0 + dt1));
+    PanZoomPoint offset = PanZoomPointMake(v1.x * t + (v1.x - v0.x) * accelerationFactor,
+        v1.y * t + (v1.y - v0.y) * accelerationFactor);
+
+    // Braking may shorten the prediction but neither reverse nor more than 
+    // double it.
+    if (v1.x * offset.x + v1.y * offset.y <= 0.0f)
+    {
+        return;
+    }
+    float maxLength = 2.0f * t * sqrtf(v1.x * v1.x + v1.y * v1.y);
+    float length = sqrtf(offset.x * offset.x + offset.y * offset.y);
+    if (length > maxLength)
+    {
+        offset.x *= maxLength / length;
+        offset.y *= maxLength / length;
+    }
+
+    // Near the bounds the prediction would push the layer past them.
+    if (state.hasPanBounds())
+    {
+        PanZoomPoint predicted = PanZoomPointMake(state.position.x + offset.x, state.position.y + offset.y);
+        PanZoomPositionLimits limits = state.positionLimits();
+        if (!PanZoomPointEqual(PanZoomState::clampPosition(state.position, limits), state.position) ||
+            !PanZoomPointEqual(PanZoomState::clampPosition(predicted, limits), predicted))
+        {
+            return;
+        }
+    }
+    predictionOffset = offset;
+}
+
+bool PanZoomController::stepFling(float step)
+{
+    PanZoomPoint target = PanZoomPointMake(state.position.x + flingVelocity.x * step, 
+        state.position.y + flingVelocity.y * step);
+    this->setPosition(target);
+
+    float decay = expf(-flingFriction * step);
+    flingVelocity.x *= decay;
+    flingVelocity.y *= decay;
+
+    if (state.hasPanBounds())
+    {
+        if (!state.rubberEffectRatio)
+        {
+            // Stop on the axes that hit the bounds.
+            if (state.position.x != target.x)
+                flingVelocity.x = 0.0f;
+            if (state.position.y != target.y)
+                flingVelocity.y = 0.0f;
+        }
+        else
+        {
+            // Brake hard while overscrolling, recovery pulls the layer back.
+            float outOfBoundsDecay = expf(-kPanZoomFlingOutOfBoundsFriction * step);
+            PanZoomEdgeDistances edges = state.edgeDistances();
+            if (edges.left || edges.right)
+                flingVelocity.x *= outOfBoundsDecay;
+            if (edges.top || edges.bottom)
+                flingVelocity.y *= outOfBoundsDecay;
+        }
+    }
+
+    if (flingVelocity.x * flingVelocity.x + flingVelocity.y * flingVelocity.y < flingMinVelocity * flingMinVelocity)
+    {
+        this->stopFling();
+        return true;
+    }
+    return false;
+}
+
+bool PanZoomController::updateFrameMode(float dt)
+{
+    // Only for frame mode with one touch.
+    if (state.mode != kCCLayerPanZoomModeFrame || touchCount != 1)
+        return false;
+
+    PanZoomPoint curPos = touches[0].position;
+
+    // Do not update position if click is still possible.
+    if (touchDistance <= maxTouchDistanceToClick)
+        return false;
+
+    // Do not update position if pinch is still possible.
+    if (clock->now() - singleTouchTimestamp < kCCLayerPanZoomMultitouchGesturesDetectionDelay)
+        return false;
+
+    // Scroll if finger in the scroll area near edge.
+    PanZoomPoint velocity;
+    if (PanZoomFrameEdgeVelocity(state.panBoundsRect, frameSettings, curPos, velocity) != kCCLayerPanZoomFrameEdgeNone)
+    {
+        this->setPosition(PanZoomPointMake(state.position.x + dt * velocity.x, 
+            state.position.y + dt * velocity.y));
+    }
+
+    // Check if touch position in layer was changed due to finger or layer movement.
+    PanZoomPoint touchPositionInLayer = state.convertToNodeSpace(curPos);
+    if (!PanZoomPointEqual(prevSingleTouchPositionInLayer, touchPositionInLayer))
+    {
+        prevSingleTouchPositionInLayer = touchPositionInLayer;
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,300 @@
+/*
+* CCLayerPanZoom
+*
+* Copyright (c) 2011 Alexey Lang
+* Copyright (c) 2011 Pavel Guganov
+*
+* http://www.cocos2d-x.org
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*
+*/
+
+
+#ifndef __PANZOOM_CONTROLLER_H__
+#define __PANZOOM_CONTROLLER_H__
+
+#include "PanZoomState.h"
+#include "PanZoomClock.h"
+#include "PanZoomStats.h"
+
+// Maximal number of simultaneously tracked touches.
+#define kPanZoomMaxTouches 10
+
+// Number of recent single touch moves used to estimate fling velocity.
+#define kPanZoomVelocitySamples 8
+// Only moves this recent (in seconds) count for the fling velocity.
+#define kPanZoomVelocityWindow 0.1
+// Fixed time step of the fling integrator, in seconds.
+#define kPanZoomFlingTimeStep (1.0f / 120.0f)
+// Friction applied on axes where the layer is out of bounds while flinging.
+#define kPanZoomFlingOutOfBoundsFriction 30.0f
+// No touch prediction when the finger didn't move for this long (seconds).
+#define kPanZoomPredictionStaleTime 0.05
+
+// Things that happened during PanZoomController::update.
+typedef enum
+{
+    kPanZoomUpdateNone = 0,
+    // Single touch position in layer changed in frame mode.
+    kPanZoomUpdateTouchPositionChanged = 1 << 0,
+    // Fling stopped.
+    kPanZoomUpdateFlingEnded = 1 << 1,
+    // Rubber effect recovery reached its target.
+    kPanZoomUpdateRecoveryEnded = 1 << 2,
+    // Coalesced touch moves began touch movement in frame mode.
+    kPanZoomUpdateTouchMoveBegan = 1 << 3,
+    // Programmatic animation reached its target.
+    kPanZoomUpdateAnimationEnded = 1 << 4
+} PanZoomUpdateEvent;
+
+// Timing of programmatic animations.
+typedef enum
+{
+    kCCLayerPanZoomEasingLinear,
+    kCCLayerPanZoomEasingEaseIn,
+    kCCLayerPanZoomEasingEaseOut,
+    kCCLayerPanZoomEasingEaseInOut
+} CCLayerPanZoomEasing;
+
+// Critically damped spring, one per animated value.
+struct PanZoomSpring
+{
+    float target;
+    float velocity;
+};
+
+struct PanZoomVelocitySample
+{
+    PanZoomPoint delta;
+    double time;
+};
+
+struct PanZoomTouch
+{
+    int touchId;
+    // Current position in GL space and the position the last gesture step
+    // was computed from.
+    PanZoomPoint position;
+    PanZoomPoint previousPosition;
+};
+
+// Centroid and spread of a group of touches.
+struct PanZoomTouchGroup
+{
+    PanZoomPoint centroid;
+    // Root mean square distance of the touches from the centroid, half the
+    // distance between the fingers for two touches.
+    float spread;
+};
+
+// Gesture handling of CCLayerPanZoom without cocos2d-x dependencies.
+// CCLayerPanZoom converts touches to GL space, forwards them here and commits
+// the resulting state to its node. All positions are in GL (parent) space.
+class PanZoomController
+{
+public:
+    PanZoomController();
+
+    PanZoomState state;
+    PanZoomFrameSettings frameSettings;
+
+    // Active touches in the order they began.
+    PanZoomTouch touches[kPanZoomMaxTouches];
+    unsigned int touchCount;
+
+    float maxTouchDistanceToClick;
+    // Path length of the single touch, accumulated by moveTouch.
+    float touchDistance;
+
+    // Coalesce touch moves: touchesMoved only marks the touches as moved and
+    // one gesture step runs per frame in update, or before touches are added
+    // or removed. touchDistance still follows every move.
+    bool coalesceTouches;
+
+    // Extract the twist of multi-touch gestures into rotation. The layer
+    // itself stays axis aligned, rotation is only reported.
+    bool rotationEnabled;
+    // Twist of the current gesture in degrees, clockwise like CCNode 
+    // rotation. Reset when the last touch lifts.
+    float rotation;
+
+    // Time when single touch has began, used to wait for possible multitouch 
+    // gestures before reacting to single touch.
+    double singleTouchTimestamp; 
+
+    // Flag used to call touchMoveBeganAtPosition: only once for each single touch event.
+    bool touchMoveBegan;
+
+    // Previous position in layer if single touch was moved.
+    PanZoomPoint prevSingleTouchPositionInLayer; 
+
+    // Rubber effect recovery springs the layer back into panBoundsRect.
+    bool rubberEffectRecovering;
+    // Recovery settles in roughly this time (seconds).
+    float rubberEffectRecoveryTime;
+    PanZoomSpring recoveryX;
+    PanZoomSpring recoveryY;
+    PanZoomSpring recoveryScale;
+
+    // Source of all gesture timing, not owned. PanZoomSystemClock by default.
+    PanZoomClock* clock;
+
+#if CC_PANZOOM_ENABLE_STATS
+    // Per frame counters and timers, frames are closed by the owner.
+    PanZoomStats stats;
+#endif
+
+    // Inertial scrolling after the last finger lifts in sheet mode, off by
+    // default.
+    bool flingEnabled;
+    // Exponential velocity decay per second.
+    float flingFriction;
+    // Fling stops below this speed (points per second).
+    float flingMinVelocity;
+    bool flinging;
+    PanZoomPoint flingVelocity;
+
+    // Touch prediction: while panning in sheet mode the layer is shown this 
+    // far (seconds) ahead along the finger's recent velocity and 
+    // acceleration. 0 disables it.
+    float predictionTime;
+    // Offset to add to state.position when the layer is displayed, zero 
+    // near the pan bounds, on direction reversal and when the finger rests.
+    PanZoomPoint predictionOffset;
+
+    // Programmatic animation started by animateTo, stopped by touches.
+    bool animating;
+
+    // Recent single touch moves in a ring buffer.
+    PanZoomVelocitySample velocitySamples[kPanZoomVelocitySamples];
+    unsigned int velocitySampleCount;
+    unsigned int velocitySampleHead;
+
+    // Moves the layer respecting bounds and rubber effect.
+    void setPosition(PanZoomPoint position);
+    void setScale(float scale);
+
+    // Touch table. Touches past kPanZoomMaxTouches and unknown ids are ignored.
+    void addTouch(int touchId, PanZoomPoint position);
+    void moveTouch(int touchId, PanZoomPoint position);
+    void removeTouch(int touchId);
+    PanZoomTouch* touchWithId(int touchId);
+
+    // Handlers called after the touches of one event were added, moved or removed.
+    void touchesBegan();
+    // Returns true when touch movement begins in frame mode, always false
+    // while coalescing.
+    bool touchesMoved();
+    // Runs the gesture step of coalesced moves now.
+    void flushTouches();
+    bool hasPendingTouchMoves() const;
+    // Starts a fling or the rubber effect recovery when the last touch ends.
+    void touchesEnded();
+    void touchesCancelled();
+    // Checked before removing ended touches.
+    bool isClickPossible() const;
+
+    // Centroid and spread of all active touches at their current or 
+    // previous positions.
+    PanZoomTouchGroup touchGroup(bool previous) const;
+
+    // Multi-touch pan & zoom step: moves the layer with the centroid and 
+    // scales it around the centroid by the ratio of the spreads.
+    void pinch(const PanZoomTouchGroup& prevGroup, const PanZoomTouchGroup& curGroup);
+    // Two finger pan & zoom step.
+    void pinch(PanZoomPoint prevPosTouch1, PanZoomPoint prevPosTouch2, 
+        PanZoomPoint curPosTouch1, PanZoomPoint curPosTouch2);
+    // Single finger step, touchDistance is accumulated by moveTouch. Returns
+    // true when touch movement begins in frame mode.
+    bool pan(PanZoomPoint prevTouchPosition, PanZoomPoint curTouchPosition);
+    // Runs coalesced moves, advances frame mode scrolling and flings, returns
+    // PanZoomUpdateEvent flags.
+    unsigned int update(float dt);
+
+    // True while update has work: a fling, a recovery, coalesced moves, 
+    // frame mode scrolling with a single touch or a touch prediction to 
+    // retract when the finger rests.
+    bool needsUpdate() const;
+
+    void stopFling();
+
+    // Animates the layer within duration seconds until nodePoint (layer 
+    // space) shows at parentPoint with scale. The scale is limited like 
+    // pinches and the layer stays within panBoundsRect along the way.
+    void animateTo(PanZoomPoint nodePoint, PanZoomPoint parentPoint, float scale, 
+        float duration, CCLayerPanZoomEasing easing);
+    // Animates rect (layer space) to the center of viewport (parent space),
+    // scaled to fit it.
+    void animateToRect(const PanZoomRect& rect, const PanZoomRect& viewport, 
+        float duration, CCLayerPanZoomEasing easing);
+    void stopAnimation();
+
+    // Starts recovery of position and scale if the layer doesn't cover 
+    // panBoundsRect. Calling it again while recovering retargets the springs
+    // and keeps their velocity.
+    void recoverPositionAndScale();
+    void stopRecovery();
+    // Velocity of the recent single touch moves, zero if the touch rested.
+    PanZoomPoint touchVelocity() const;
+    // Recomputes predictionOffset, called after touch steps and updates.
+    void updatePrediction();
+
+private:
+    double _flingAccumulator;
+    bool _touchesMovedPending;
+    // Touch movement began in a coalesced step, reported by update.
+    bool _touchMoveBeganPending;
+
+    // Gesture step with the touches moved since the previous step.
+    bool stepTouches();
+    // Last three single touch positions, oldest first.
+    PanZoomPoint _predictionPositions[3];
+    double _predictionTimes[3];
+    unsigned int _predictionSampleCount;
+
+    void addVelocitySample(PanZoomPoint delta);
+    void addPredictionSample(PanZoomPoint position);
+    // Starts the next gesture step from the current touch positions.
+    void rebaseTouches();
+    // Rotation of the touches around the group centroids, in degrees.
+    float touchRotation(const PanZoomTouchGroup& prevGroup, const PanZoomTouchGroup& curGroup) const;
+    // Returns true when the fling stops.
+    bool stepFling(float step);
+    // Returns true when the recovery reaches its target.
+    bool stepRecovery(float dt);
+
+    // The layer point shown at _animationAnchor moves from the start to the
+    // end center while the scale changes geometrically.
+    PanZoomPoint _animationAnchor;
+    PanZoomPoint _animationStartCenter;
+    PanZoomPoint _animationEndCenter;
+    float _animationStartScale;
+    float _animationEndScale;
+    float _animationTime;
+    float _animationDuration;
+    CCLayerPanZoomEasing _animationEasing;
+    // Returns true when the animation reaches its target.
+    bool stepAnimation(float dt);
+    // Frame mode scrolling with the single touch. Returns true if touch
+    // position in layer was changed due to finger or layer movement.
+    bool updateFrameMode(float dt);
+};
+
+#endif // __PANZOOM_CONTROLLER_H__
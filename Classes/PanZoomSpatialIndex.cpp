@@ -0,0 +1,316 @@
+/*
+* CCLayerPanZoom
+*
+* Copyright (c) 2011 Alexey Lang
+* Copyright (c) 2011 Pavel Guganov
+*
+* http://www.cocos2d-x.org
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*
+*/
+
+
+#include "PanZoomSpatialIndex.h"
+
+#include <algorithm>
+#include <stddef.h>
+
+#ifndef MIN
+#define MIN(x,y) (((x) > (y)) ? (y) : (x))
+#endif
+#ifndef MAX
+#define MAX(x,y) (((x) < (y)) ? (y) : (x))
+#endif
+
+struct PanZoomSpatialIndex::EntryOnTop
+{
+    const std::vector<Entry>* entries;
+
+    bool operator()(int a, int b) const
+    {
+        const Entry& ea = (*entries)[a];
+        const Entry& eb = (*entries)[b];
+        if (ea.zOrder != eb.zOrder)
+        {
+            return ea.zOrder > eb.zOrder;
+        }
+        return ea.orderOfArrival > eb.orderOfArrival;
+    }
+};
+
+PanZoomSpatialIndex::PanZoomSpatialIndex()
+    : _bounds(PanZoomRectMake(0.0f, 0.0f, 0.0f, 0.0f)),
+      _cellSize(kPanZoomSpatialIndexDefaultCellSize),
+      _columns(1),
+      _rows(1),
+      _cells(1),
+      _queryStamp(0)
+{
+}
+
+void PanZoomSpatialIndex::setGrid(const PanZoomRect& bounds, float cellSize)
+{
+    _bounds = bounds;
+    _cellSize = MAX(cellSize, 1.0f);
+    float maxSide = MAX(bounds.size.width, bounds.size.height);
+    if (maxSide / _cellSize > kPanZoomSpatialIndexMaxCellsPerAxis)
+    {
+        _cellSize = maxSide / kPanZoomSpatialIndexMaxCellsPerAxis;
+    }
+    _columns = MAX((int)ceilf(bounds.size.width / _cellSize), 1);
+    _rows = MAX((int)ceilf(bounds.size.height / _cellSize), 1);
+
+    _cells.clear();
+    _cells.resize(_columns * _rows);
+    for (int i = 0; i < (int)_entries.size(); ++i)
+    {
+        if (_entries[i].item)
+        {
+            this->link(i);
+        }
+    }
+}
+
+int PanZoomSpatialIndex::columnForX(float x) const
+{
+    int column = (int)floorf((x - _bounds.origin.x) / _cellSize);
+    return MAX(MIN(column, _columns - 1), 0);
+}
+
+int PanZoomSpatialIndex::rowForY(float y) const
+{
+    int row = (int)floorf((y - _bounds.origin.y) / _cellSize);
+    return MAX(MIN(row, _rows - 1), 0);
+}
+
+void PanZoomSpatialIndex::link(int entryIndex)
+{
+    Entry& entry = _entries[entryIndex];
+    entry.minColumn = this->columnForX(entry.rect.origin.x);
+    entry.maxColumn = this->columnForX(entry.rect.origin.x + entry.rect.size.width);
+    entry.minRow = this->rowForY(entry.rect.origin.y);
+    entry.maxRow = this->rowForY(entry.rect.origin.y + entry.rect.size.height);
+    for (int row = entry.minRow; row <= entry.maxRow; ++row)
+    {
+        for (int column = entry.minColumn; column <= entry.maxColumn; ++column)
+        {
+            _cells[row * _columns + column].push_back(entryIndex);
+        }
+    }
+}
+
+void PanZoomSpatialIndex::unlink(int entryIndex)
+{
+    const Entry& entry = _entries[entryIndex];
+    for (int row = entry.minRow; row <= entry.maxRow; ++row)
+    {
+        for (int column = entry.minColumn; column <= entry.maxColumn; ++column)
+        {
+            std::vector<int>& cell = _cells[row * _columns + column];
+            std::vector<int>::iterator it = std::find(cell.begin(), cell.end(), entryIndex);
+            if (it != cell.end())
+            {
+                *it = cell.back();
+                cell.pop_back();
+            }
+        }
+    }
+}
+
+void PanZoomSpatialIndex::insert(void* item, const PanZoomRect& rect, int zOrder, unsigned int orderOfArrival)
+{
+    std::map<void*, int>::iterator found = _entryForItem.find(item);
+    if (found != _entryForItem.end())
+    {
+        this->update(item, rect);
+        this->setOrder(item, zOrder, orderOfArrival);
+        return;
+    }
+
+    int entryIndex;
+    if (_freeEntries.empty())
+    {
+        entryIndex = (int)_entries.size();
+        _entries.push_back(Entry());
+    }
+    else
+    {
+        entryIndex = _freeEntries.back();
+        _freeEntries.pop_back();
+    }
+    Entry& entry = _entries[entryIndex];
+    entry.item = item;
+    entry.rect = rect;
+    entry.zOrder = zOrder;
+    entry.orderOfArrival = orderOfArrival;
+    entry.queryStamp = 0;
+    _entryForItem[item] = entryIndex;
+    this->link(entryIndex);
+}
+
+void PanZoomSpatialIndex::update(void* item, const PanZoomRect& rect)
+{
+    std::map<void*, int>::iterator found = _entryForItem.find(item);
+    if (found == _entryForItem.end())
+    {
+        return;
+    }
+    Entry& entry = _entries[found->second];
+    if (this->columnForX(rect.origin.x) == entry.minColumn && 
+        this->columnForX(rect.origin.x + rect.size.width) == entry.maxColumn &&
+        this->rowForY(rect.origin.y) == entry.minRow && 
+        this->rowForY(rect.origin.y + rect.size.height) == entry.maxRow)
+    {
+        // Still in the same cells.
+        entry.rect = rect;
+        return;
+    }
+    this->unlink(found->second);
+    entry.rect = rect;
+    this->link(found->second);
+}
+
+void PanZoomSpatialIndex::setOrder(void* item, int zOrder, unsigned int orderOfArrival)
+{
+    std::map<void*, int>::iterator found = _entryForItem.find(item);
+    if (found != _entryForItem.end())
+    {
+        _entries[found->second].zOrder = zOrder;
+        _entries[found->second].orderOfArrival = orderOfArrival;
+    }
+}
+
+void PanZoomSpatialIndex::remove(void* item)
+{
+    std::map<void*, int>::iterator found = _entryForItem.find(item);
+    if (found == _entryForItem.end())
+    {
+        return;
+    }
+    this->unlink(found->second);
+    _entries[found->second].item = NULL;
+    _freeEntries.push_back(found->second);
+    _entryForItem.erase(found);
+}
+
+void PanZoomSpatialIndex::clear()
+{
+    for (size_t i = 0; i < _cells.size(); ++i)
+    {
+        _cells[i].clear();
+    }
+    _entries.clear();
+    _freeEntries.clear();
+    _entryForItem.clear();
+}
+
+bool PanZoomSpatialIndex::contains(void* item) const
+{
+    return _entryForItem.find(item) != _entryForItem.end();
+}
+
+unsigned int PanZoomSpatialIndex::count() const
+{
+    return (unsigned int)_entryForItem.size();
+}
+
+void PanZoomSpatialIndex::query(const PanZoomRect& rect, std::vector<void*>& result)
+{
+    if (++_queryStamp == 0)
+    {
+        // Stamp wrapped, forget old stamps.
+        for (size_t i = 0; i < _entries.size(); ++i)
+        {
+            _entries[i].queryStamp = 0;
+        }
+        _queryStamp = 1;
+    }
+
+    int minColumn = this->columnForX(rect.origin.x);
+    int maxColumn = this->columnForX(rect.origin.x + rect.size.width);
+    int minRow = this->rowForY(rect.origin.y);
+    int maxRow = this->rowForY(rect.origin.y + rect.size.height);
+    for (int row = minRow; row <= maxRow; ++row)
+    {
+        for (int column = minColumn; column <= maxColumn; ++column)
+        {
+            const std::vector<int>& cell = _cells[row * _columns + column];
+            for (size_t i = 0; i < cell.size(); ++i)
+            {
+                Entry& entry = _entries[cell[i]];
+                if (entry.queryStamp != _queryStamp && PanZoomRectIntersects(entry.rect, rect))
+                {
+                    entry.queryStamp = _queryStamp;
+                    result.push_back(entry.item);
+                }
+            }
+        }
+    }
+}
+
+bool PanZoomSpatialIndex::isInLastQuery(void* item) const
+{
+    std::map<void*, int>::const_iterator found = _entryForItem.find(item);
+    // Stamps start at 1, items inserted before the first query aren't in it.
+    return found != _entryForItem.end() && _queryStamp != 0 && 
+        _entries[found->second].queryStamp == _queryStamp;
+}
+
+bool PanZoomSpatialIndex::entryContainsPoint(int entryIndex, const PanZoomPoint& point) const
+{
+    return PanZoomRectContainsPoint(_entries[entryIndex].rect, point);
+}
+
+void PanZoomSpatialIndex::queryPoint(const PanZoomPoint& point, std::vector<void*>& result)
+{
+    _pointHits.clear();
+    const std::vector<int>& cell = _cells[this->rowForY(point.y) * _columns + this->columnForX(point.x)];
+    for (size_t i = 0; i < cell.size(); ++i)
+    {
+        if (this->entryContainsPoint(cell[i], point))
+        {
+            _pointHits.push_back(cell[i]);
+        }
+    }
+
+    EntryOnTop onTop;
+    onTop.entries = &_entries;
+    std::sort(_pointHits.begin(), _pointHits.end(), onTop);
+    for (size_t i = 0; i < _pointHits.size(); ++i)
+    {
+        result.push_back(_entries[_pointHits[i]].item);
+    }
+}
+
+void* PanZoomSpatialIndex::topmostAt(const PanZoomPoint& point) const
+{
+    EntryOnTop onTop;
+    onTop.entries = &_entries;
+    int topmost = -1;
+    const std::vector<int>& cell = _cells[this->rowForY(point.y) * _columns + this->columnForX(point.x)];
+    for (size_t i = 0; i < cell.size(); ++i)
+    {
+        if (this->entryContainsPoint(cell[i], point) && (topmost < 0 || onTop(cell[i], topmost)))
+        {
+            topmost = cell[i];
+        }
+    }
+    return topmost < 0 ? NULL : _entries[topmost].item;
+}
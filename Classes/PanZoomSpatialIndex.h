@@ -0,0 +1,107 @@
+/*
+* CCLayerPanZoom
+*
+* Copyright (c) 2011 Alexey Lang
+* Copyright (c) 2011 Pavel Guganov
+*
+* http://www.cocos2d-x.org
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*
+*/
+
+
+#ifndef __PANZOOM_SPATIAL_INDEX_H__
+#define __PANZOOM_SPATIAL_INDEX_H__
+
+#include "PanZoomState.h"
+
+#include <map>
+#include <vector>
+
+// Grid cells per axis are capped, larger content gets larger cells.
+#define kPanZoomSpatialIndexMaxCellsPerAxis 256
+#define kPanZoomSpatialIndexDefaultCellSize 256.0f
+
+// Uniform grid over content space. Items (opaque pointers, e.g. layer 
+// children) are bucketed into every cell their rect overlaps, so rect and 
+// point queries only look at the cells they touch. Rects outside the grid 
+// are kept in the border cells.
+class PanZoomSpatialIndex
+{
+public:
+    PanZoomSpatialIndex();
+
+    // Sets the indexed area and cell size, existing items are rebucketed.
+    void setGrid(const PanZoomRect& bounds, float cellSize);
+    const PanZoomRect& bounds() const { return _bounds; }
+    float cellSize() const { return _cellSize; }
+
+    // Items drawn later are on top: higher zOrder, then higher orderOfArrival.
+    void insert(void* item, const PanZoomRect& rect, int zOrder, unsigned int orderOfArrival);
+    void update(void* item, const PanZoomRect& rect);
+    void setOrder(void* item, int zOrder, unsigned int orderOfArrival);
+    void remove(void* item);
+    void clear();
+    bool contains(void* item) const;
+    unsigned int count() const;
+
+    // Appends items whose rect intersects rect, each item once.
+    void query(const PanZoomRect& rect, std::vector<void*>& result);
+    // Whether item was returned by the last query().
+    bool isInLastQuery(void* item) const;
+    // Appends items whose rect contains point, topmost first.
+    void queryPoint(const PanZoomPoint& point, std::vector<void*>& result);
+    // Topmost item containing point or NULL.
+    void* topmostAt(const PanZoomPoint& point) const;
+
+private:
+    // Lets the host tests start a query stamp near its wraparound.
+    friend class PanZoomSpatialIndexTest;
+
+    struct Entry
+    {
+        void* item;
+        PanZoomRect rect;
+        int zOrder;
+        unsigned int orderOfArrival;
+        int minColumn, maxColumn, minRow, maxRow;
+        unsigned int queryStamp;
+    };
+    struct EntryOnTop;
+
+    int columnForX(float x) const;
+    int rowForY(float y) const;
+    bool entryContainsPoint(int entryIndex, const PanZoomPoint& point) const;
+    void link(int entryIndex);
+    void unlink(int entryIndex);
+
+    PanZoomRect _bounds;
+    float _cellSize;
+    int _columns;
+    int _rows;
+    std::vector<Entry> _entries;
+    std::vector<int> _freeEntries;
+    std::map<void*, int> _entryForItem;
+    std::vector< std::vector<int> > _cells;
+    std::vector<int> _pointHits;
+    unsigned int _queryStamp;
+};
+
+#endif // __PANZOOM_SPATIAL_INDEX_H__
@@ -0,0 +1,491 @@
+/*
+* CCLayerPanZoom
+*
+* Copyright (c) 2011 Alexey Lang
+* Copyright (c) 2011 Pavel Guganov
+*
+* http://www.cocos2d-x.org
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*
+*/
+
+
+#include "PanZoomState.h"
+
+#ifndef MIN
+#define MIN(x,y) (((x) > (y)) ? (y) : (x))
+#endif
+#ifndef MAX
+#define MAX(x,y) (((x) < (y)) ? (y) : (x))
+#endif
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define PANZOOM_SSE 1
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define PANZOOM_NEON 1
+#endif
+
+// out = xy * scale + (offsetX, offsetY) for n interleaved points.
+static void PanZoomTransformPoints(const float* xy, float* out, size_t n, 
+    float scale, float offsetX, float offsetY)
+{
+    size_t count = n * 2;
+    size_t i = 0;
+#if defined(PANZOOM_SSE)
+    // Two points per register.
+    __m128 scales = _mm_set1_ps(scale);
+    __m128 offsets = _mm_setr_ps(offsetX, offsetY, offsetX, offsetY);
+    for (; i + 8 <= count; i += 8)
+    {
+        __m128 a = _mm_loadu_ps(xy + i);
+        __m128 b = _mm_loadu_ps(xy + i + 4);
+        _mm_storeu_ps(out + i, _mm_add_ps(_mm_mul_ps(a, scales), offsets));
+        _mm_storeu_ps(out + i + 4, _mm_add_ps(_mm_mul_ps(b, scales), offsets));
+    }
+#elif defined(PANZOOM_NEON)
+    float32x4_t scales = vdupq_n_f32(scale);
+    float offsetValues[4] = { offsetX, offsetY, offsetX, offsetY };
+    float32x4_t offsets = vld1q_f32(offsetValues);
+    for (; i + 8 <= count; i += 8)
+    {
+        float32x4_t a = vld1q_f32(xy + i);
+        float32x4_t b = vld1q_f32(xy + i + 4);
+        vst1q_f32(out + i, vaddq_f32(vmulq_f32(a, scales), offsets));
+        vst1q_f32(out + i + 4, vaddq_f32(vmulq_f32(b, scales), offsets));
+    }
+#endif
+    for (; i < count; i += 2)
+    {
+        out[i] = xy[i] * scale + offsetX;
+        out[i + 1] = xy[i + 1] * scale + offsetY;
+    }
+}
+
+
+PanZoomTransformVersion::PanZoomTransformVersion()
+: version(0)
+{
+    for (unsigned int i = 0; i < kCCLayerPanZoomDirtyFlagCount; ++i)
+    {
+        dirtyVersions[i] = 0;
+    }
+}
+
+void PanZoomTransformVersion::markDirty(unsigned int dirtyFlags)
+{
+    ++version;
+    for (unsigned int i = 0; i < kCCLayerPanZoomDirtyFlagCount; ++i)
+    {
+        if (dirtyFlags & (1 << i))
+        {
+            dirtyVersions[i] = version;
+        }
+    }
+}
+
+unsigned int PanZoomTransformVersion::dirtyFlagsSince(unsigned int sinceVersion) const
+{
+    unsigned int dirtyFlags = kCCLayerPanZoomDirtyNone;
+    for (unsigned int i = 0; i < kCCLayerPanZoomDirtyFlagCount; ++i)
+    {
+        if (dirtyVersions[i] > sinceVersion)
+        {
+            dirtyFlags |= 1 << i;
+        }
+    }
+    return dirtyFlags;
+}
+
+PanZoomState::PanZoomState()
+: position(PanZoomPointMake(0.0f, 0.0f))
+, scale(1.0f)
+, anchorPoint(PanZoomPointMake(0.5f, 0.5f))
+, contentSize(PanZoomSizeMake(0.0f, 0.0f))
+, ignoreAnchorPointForPosition(true)
+, panBoundsRect(PanZoomRectMake(0.0f, 0.0f, 0.0f, 0.0f))
+, minScale(0.7f)
+, maxScale(3.0f)
+, rubberEffectRatio(0.0f)
+, mode(kCCLayerPanZoomModeSheet)
+{
+    _nodeTransform.valid = false;
+}
+
+bool PanZoomState::hasPanBounds() const
+{
+    return !PanZoomRectIsZero(panBoundsRect);
+}
+
+const PanZoomState::NodeTransform& PanZoomState::nodeTransform() const
+{
+    NodeTransform& transform = _nodeTransform;
+    if (transform.valid && 
+        PanZoomPointEqual(transform.position, position) && 
+        transform.scale == scale && 
+        PanZoomPointEqual(transform.anchorPoint, anchorPoint) && 
+        transform.contentSize.width == contentSize.width && 
+        transform.contentSize.height == contentSize.height &&
+        transform.ignoreAnchorPointForPosition == ignoreAnchorPointForPosition)
+    {
+        return transform;
+    }
+
+    // CCNode::nodeToParentTransform without rotation and skew.
+    float anchorX = anchorPoint.x * contentSize.width;
+    float anchorY = anchorPoint.y * contentSize.height;
+    float x = position.x;
+    float y = position.y;
+    if (ignoreAnchorPointForPosition)
+    {
+        x += anchorX;
+        y += anchorY;
+    }
+
+    transform.valid = true;
+    transform.position = position;
+    transform.scale = scale;
+    transform.anchorPoint = anchorPoint;
+    transform.contentSize = contentSize;
+    transform.ignoreAnchorPointForPosition = ignoreAnchorPointForPosition;
+    transform.inverseScale = 1.0f / scale;
+    transform.toNodeOffset = PanZoomPointMake(anchorX - x * transform.inverseScale, 
+        anchorY - y * transform.inverseScale);
+    transform.toParentOffset = PanZoomPointMake(x - anchorX * scale, y - anchorY * scale);
+    return transform;
+}
+
+PanZoomPoint PanZoomState::convertToNodeSpace(PanZoomPoint point) const
+{
+    const NodeTransform& transform = this->nodeTransform();
+    return PanZoomPointMake(point.x * transform.inverseScale + transform.toNodeOffset.x, 
+        point.y * transform.inverseScale + transform.toNodeOffset.y);
+}
+
+PanZoomPoint PanZoomState::convertToParentSpace(PanZoomPoint point) const
+{
+    const NodeTransform& transform = this->nodeTransform();
+    return PanZoomPointMake(point.x * transform.scale + transform.toParentOffset.x, 
+        point.y * transform.scale + transform.toParentOffset.y);
+}
+
+void PanZoomState::convertToNodeSpace(const float* xy, float* out, size_t n) const
+{
+    const NodeTransform& transform = this->nodeTransform();
+    PanZoomTransformPoints(xy, out, n, transform.inverseScale, transform.toNodeOffset.x, transform.toNodeOffset.y);
+}
+
+void PanZoomState::convertToParentSpace(const float* xy, float* out, size_t n) const
+{
+    const NodeTransform& transform = this->nodeTransform();
+    PanZoomTransformPoints(xy, out, n, transform.scale, transform.toParentOffset.x, transform.toParentOffset.y);
+}
+
+PanZoomPoint PanZoomState::positionForPoint(PanZoomPoint nodePoint, PanZoomPoint parentPoint) const
+{
+    // The parent space offset moves one to one with the position.
+    PanZoomPoint current = this->convertToParentSpace(nodePoint);
+    return PanZoomPointMake(position.x + parentPoint.x - current.x, position.y + parentPoint.y - current.y);
+}
+
+PanZoomRect PanZoomState::visibleRect(const PanZoomRect& viewport) const
+{
+    // No rotation, so the transform keeps rects axis aligned.
+    PanZoomPoint origin = this->convertToNodeSpace(viewport.origin);
+    const NodeTransform& transform = this->nodeTransform();
+    return PanZoomRectMake(origin.x, origin.y, 
+        viewport.size.width * transform.inverseScale, viewport.size.height * transform.inverseScale);
+}
+
+float PanZoomState::clampScale(float scale) const
+{
+    return MIN(MAX(scale, minScale), maxScale);
+}
+
+float PanZoomState::minPossibleScale() const
+{
+    if (this->hasPanBounds())
+    {
+        return MAX(panBoundsRect.size.width / contentSize.width,
+            panBoundsRect.size.height / contentSize.height);
+    }
+    else 
+    {
+        return minScale;
+    }
+}
+
+PanZoomPositionLimits PanZoomState::positionLimits(const PanZoomRect& panBoundsRect, 
+    PanZoomSize scaledSize, PanZoomPoint anchorPoint)
+{
+    PanZoomPositionLimits limits;
+    limits.maxX = panBoundsRect.origin.x + scaledSize.width * anchorPoint.x;
+    limits.minX = panBoundsRect.origin.x + panBoundsRect.size.width - scaledSize.width * (1 - anchorPoint.x);
+    limits.maxY = panBoundsRect.origin.y + scaledSize.height * anchorPoint.y;
+    limits.minY = panBoundsRect.origin.y + panBoundsRect.size.height - scaledSize.height * (1 - anchorPoint.y);
+    return limits;
+}
+
+PanZoomPositionLimits PanZoomState::positionLimits() const
+{
+    return PanZoomState::positionLimits(panBoundsRect, 
+        PanZoomSizeMake(contentSize.width * scale, contentSize.height * scale), anchorPoint);
+}
+
+PanZoomPoint PanZoomState::clampPosition(PanZoomPoint position, const PanZoomPositionLimits& limits)
+{
+    return PanZoomPointMake(MAX(MIN(position.x, limits.maxX), limits.minX), 
+        MAX(MIN(position.y, limits.maxY), limits.minY));
+}
+
+PanZoomEdgeDistances PanZoomState::edgeDistances() const
+{
+    PanZoomPositionLimits limits = this->positionLimits();
+    PanZoomEdgeDistances distances;
+    distances.top = (int)(MAX(limits.minY - position.y, 0));
+    distances.left = (int)(MAX(position.x - limits.maxX, 0));
+    distances.bottom = (int)(MAX(position.y - limits.maxY, 0));
+    distances.right = (int)(MAX(limits.minX - position.x, 0));
+    return distances;
+}
+
+float PanZoomState::topEdgeDistance() const
+{
+    return this->edgeDistances().top;
+}
+
+float PanZoomState::leftEdgeDistance() const
+{
+    return this->edgeDistances().left;
+}
+
+float PanZoomState::bottomEdgeDistance() const
+{
+    return this->edgeDistances().bottom;
+}
+
+float PanZoomState::rightEdgeDistance() const
+{
+    return this->edgeDistances().right;
+}
+
+PanZoomPoint PanZoomState::boundedPosition(PanZoomPoint pos) const
+{
+    return PanZoomState::clampPosition(pos, this->positionLimits());
+}
+
+PanZoomPoint PanZoomState::constrainedPosition(PanZoomPoint prevPosition, PanZoomPoint pos,
+    bool rubberEffectRecovering) const
+{
+    if (!this->hasPanBounds())
+    {
+        return pos;
+    }
+
+    if (rubberEffectRatio && mode == kCCLayerPanZoomModeSheet)
+    {
+        if (!rubberEffectRecovering)
+        {
+            // Slow down movement along the axes where the layer doesn't cover
+            // the bounds (edge distance of at least one whole point).
+            PanZoomPositionLimits limits = this->positionLimits();
+            bool outY = pos.y - limits.maxY >= 1.0f || limits.minY - pos.y >= 1.0f;
+            bool outX = pos.x - limits.maxX >= 1.0f || limits.minX - pos.x >= 1.0f;
+            if (outY)
+            {
+                pos.y = prevPosition.y + (pos.y - prevPosition.y) * rubberEffectRatio;
+            }
+            if (outX)
+            {
+                pos.x = prevPosition.x + (pos.x - prevPosition.x) * rubberEffectRatio;
+            }
+        }
+        return pos;
+    }
+
+    return this->boundedPosition(pos);
+}
+
+
+// Shape of the built-in curves at t in 0..1.
+static float PanZoomEdgeSpeedCurveValue(CCLayerPanZoomEdgeSpeedCurve curve, float t)
+{
+    switch (curve)
+    {
+    case kCCLayerPanZoomEdgeSpeedCurveEaseIn:
+        return t * t;
+    case kCCLayerPanZoomEdgeSpeedCurveEaseOut:
+        return 1.0f - (1.0f - t) * (1.0f - t);
+    case kCCLayerPanZoomEdgeSpeedCurveEaseInOut:
+        return t * t * (3.0f - 2.0f * t);
+    default:
+        return t;
+    }
+}
+
+void PanZoomFrameSettings::precompute()
+{
+    for (unsigned int i = 0; i <= kPanZoomEdgeSpeedTableSegments; ++i)
+    {
+        float t = (float)i / kPanZoomEdgeSpeedTableSegments;
+        float value = speedCurve == kCCLayerPanZoomEdgeSpeedCurveCustom ? 
+            customSpeedCurve[i] : PanZoomEdgeSpeedCurveValue(speedCurve, t);
+        speedTable[i] = minSpeed + (maxSpeed - minSpeed) * value;
+    }
+    inverseTopMargin = topMargin > 0.0f ? 1.0f / topMargin : 0.0f;
+    inverseBottomMargin = bottomMargin > 0.0f ? 1.0f / bottomMargin : 0.0f;
+    inverseLeftMargin = leftMargin > 0.0f ? 1.0f / leftMargin : 0.0f;
+    inverseRightMargin = rightMargin > 0.0f ? 1.0f / rightMargin : 0.0f;
+}
+
+void PanZoomFrameSettings::setCustomSpeedCurve(const float* values, unsigned int count)
+{
+    if (count < 2)
+    {
+        return;
+    }
+    // Linear resampling of the samples to the table.
+    for (unsigned int i = 0; i <= kPanZoomEdgeSpeedTableSegments; ++i)
+    {
+        float position = (float)i * (count - 1) / kPanZoomEdgeSpeedTableSegments;
+        unsigned int index = MIN((unsigned int)position, count - 2);
+        float fraction = position - index;
+        customSpeedCurve[i] = values[index] + (values[index + 1] - values[index]) * fraction;
+    }
+    speedCurve = kCCLayerPanZoomEdgeSpeedCurveCustom;
+    this->precompute();
+}
+
+float PanZoomFrameSettings::speedAtDepth(float depth) const
+{
+    float position = MAX(depth, 0.0f) * kPanZoomEdgeSpeedTableSegments;
+    unsigned int index = (unsigned int)MIN(position, (float)kPanZoomEdgeSpeedTableSegments);
+    if (index >= kPanZoomEdgeSpeedTableSegments)
+    {
+        // Beyond the bounds the curve goes on along its last segment, like
+        // the linear speeds always did.
+        const float* last = &speedTable[kPanZoomEdgeSpeedTableSegments];
+        return *last + (*last - *(last - 1)) * (position - kPanZoomEdgeSpeedTableSegments);
+    }
+    float fraction = position - index;
+    return speedTable[index] + (speedTable[index + 1] - speedTable[index]) * fraction;
+}
+
+CCLayerPanZoomFrameEdge PanZoomFrameEdgeVelocity(const PanZoomRect& panBoundsRect, 
+    const PanZoomFrameSettings& settings, PanZoomPoint point, PanZoomPoint& velocity)
+{
+    velocity = PanZoomPointMake(0.0f, 0.0f);
+    CCLayerPanZoomFrameEdge edge = PanZoomFrameEdgeWithPoint(panBoundsRect, settings, point);
+    if (edge == kCCLayerPanZoomFrameEdgeNone)
+    {
+        return edge;
+    }
+
+    // In corners the depth counts along the diagonal.
+    bool corner = edge >= kCCLayerPanZoomFrameEdgeTopLeft;
+    float depthScale = corner ? 0.70710678f : 1.0f;
+    float leftEdge = panBoundsRect.origin.x + settings.leftMargin;
+    float rightEdge = panBoundsRect.origin.x + panBoundsRect.size.width - settings.rightMargin;
+    float bottomEdge = panBoundsRect.origin.y + settings.bottomMargin;
+    float topEdge = panBoundsRect.origin.y + panBoundsRect.size.height - settings.topMargin;
+
+    if (edge == kCCLayerPanZoomFrameEdgeLeft || edge == kCCLayerPanZoomFrameEdgeTopLeft || 
+        edge == kCCLayerPanZoomFrameEdgeBottomLeft)
+    {
+        velocity.x = settings.speedAtDepth((leftEdge - point.x) * settings.inverseLeftMargin * depthScale);
+    }
+    else if (edge != kCCLayerPanZoomFrameEdgeTop && edge != kCCLayerPanZoomFrameEdgeBottom)
+    {
+        velocity.x = -settings.speedAtDepth((point.x - rightEdge) * settings.inverseRightMargin * depthScale);
+    }
+
+    if (edge == kCCLayerPanZoomFrameEdgeBottom || edge == kCCLayerPanZoomFrameEdgeBottomLeft || 
+        edge == kCCLayerPanZoomFrameEdgeBottomRight)
+    {
+        velocity.y = settings.speedAtDepth((bottomEdge - point.y) * settings.inverseBottomMargin * depthScale);
+    }
+    else if (edge != kCCLayerPanZoomFrameEdgeLeft && edge != kCCLayerPanZoomFrameEdgeRight)
+    {
+        velocity.y = -settings.speedAtDepth((point.y - topEdge) * settings.inverseTopMargin * depthScale);
+    }
+    return edge;
+}
+
+CCLayerPanZoomFrameEdge PanZoomFrameEdgeWithPoint(const PanZoomRect& panBoundsRect, 
+    const PanZoomFrameSettings& settings, PanZoomPoint point)
+{
+    bool isLeft = point.x <= panBoundsRect.origin.x + settings.leftMargin;
+    bool isRight = point.x >= panBoundsRect.origin.x + panBoundsRect.size.width - settings.rightMargin;
+    bool isBottom = point.y <= panBoundsRect.origin.y + settings.bottomMargin;
+    bool isTop = point.y >= panBoundsRect.origin.y + panBoundsRect.size.height - settings.topMargin;
+
+    if (isLeft && isBottom)
+    {
+        return kCCLayerPanZoomFrameEdgeBottomLeft;
+    }
+    if (isLeft && isTop)
+    {
+        return kCCLayerPanZoomFrameEdgeTopLeft;
+    }
+    if (isRight && isBottom)
+    {
+        return kCCLayerPanZoomFrameEdgeBottomRight;
+    }
+    if (isRight && isTop)
+    {
+        return kCCLayerPanZoomFrameEdgeTopRight;
+    }
+
+    if (isLeft)
+    {
+        return kCCLayerPanZoomFrameEdgeLeft;
+    }
+    if (isTop)
+    {
+        return kCCLayerPanZoomFrameEdgeTop;
+    }
+    if (isRight)
+    {
+        return kCCLayerPanZoomFrameEdgeRight;
+    }
+    if (isBottom)
+    {
+        return kCCLayerPanZoomFrameEdgeBottom;
+    }
+
+    return kCCLayerPanZoomFrameEdgeNone;
+}
+
+float PanZoomHorSpeedWithPosition(const PanZoomRect& panBoundsRect, 
+    const PanZoomFrameSettings& settings, PanZoomPoint pos)
+{
+    PanZoomPoint velocity;
+    PanZoomFrameEdgeVelocity(panBoundsRect, settings, pos, velocity);
+    return velocity.x;
+}
+
+float PanZoomVertSpeedWithPosition(const PanZoomRect& panBoundsRect, 
+    const PanZoomFrameSettings& settings, PanZoomPoint pos)
+{
+    PanZoomPoint velocity;
+    PanZoomFrameEdgeVelocity(panBoundsRect, settings, pos, velocity);
+    return velocity.y;
+}
@@ -0,0 +1,357 @@
+/*
+* CCLayerPanZoom
+*
+* Copyright (c) 2011 Alexey Lang
+* Copyright (c) 2011 Pavel Guganov
+*
+* http://www.cocos2d-x.org
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*
+*/
+
+
+#ifndef __PANZOOM_STATE_H__
+#define __PANZOOM_STATE_H__
+
+// Engine independent pan/zoom math used by CCLayerPanZoom.
+// Nothing here depends on cocos2d-x, so it can be built and profiled on a host
+// without a GL context.
+
+#include <math.h>
+#include <stddef.h>
+
+#define kCCLayerPanZoomMultitouchGesturesDetectionDelay 0.5
+
+#ifndef INFINITY
+#ifdef _MSC_VER
+union MSVC_EVIL_FLOAT_HACK
+{
+    unsigned __int8 Bytes[4];
+    float Value;
+};
+static union MSVC_EVIL_FLOAT_HACK INFINITY_HACK = {{0x00, 0x00, 0x80, 0x7F}};
+#define INFINITY (INFINITY_HACK.Value)
+#endif
+
+#ifdef __GNUC__
+#define INFINITY (__builtin_inf())
+#endif
+
+#ifndef INFINITY
+#define INFINITY (1e1000)
+#endif
+#endif
+
+
+typedef enum
+{
+    /** Standard mode: swipe to scroll */
+    kCCLayerPanZoomModeSheet,
+    /** Frame mode (i.e. drag inside objects): hold finger at edge of the screen to the sroll in this direction */
+    kCCLayerPanZoomModeFrame  
+} CCLayerPanZoomMode;
+
+
+typedef enum
+{
+    kCCLayerPanZoomFrameEdgeNone,
+    kCCLayerPanZoomFrameEdgeTop,
+    kCCLayerPanZoomFrameEdgeBottom,
+    kCCLayerPanZoomFrameEdgeLeft,
+    kCCLayerPanZoomFrameEdgeRight,
+    kCCLayerPanZoomFrameEdgeTopLeft,
+    kCCLayerPanZoomFrameEdgeBottomLeft,
+    kCCLayerPanZoomFrameEdgeTopRight,
+    kCCLayerPanZoomFrameEdgeBottomRight
+} CCLayerPanZoomFrameEdge;
+
+
+struct PanZoomPoint
+{
+    float x;
+    float y;
+};
+
+struct PanZoomSize
+{
+    float width;
+    float height;
+};
+
+struct PanZoomRect
+{
+    PanZoomPoint origin;
+    PanZoomSize size;
+};
+
+inline PanZoomPoint PanZoomPointMake(float x, float y)
+{
+    PanZoomPoint point = { x, y };
+    return point;
+}
+
+inline PanZoomSize PanZoomSizeMake(float width, float height)
+{
+    PanZoomSize size = { width, height };
+    return size;
+}
+
+inline PanZoomRect PanZoomRectMake(float x, float y, float width, float height)
+{
+    PanZoomRect rect = { { x, y }, { width, height } };
+    return rect;
+}
+
+inline bool PanZoomPointEqual(const PanZoomPoint& a, const PanZoomPoint& b)
+{
+    return a.x == b.x && a.y == b.y;
+}
+
+inline bool PanZoomRectIsZero(const PanZoomRect& rect)
+{
+    return rect.origin.x == 0.0f && rect.origin.y == 0.0f && 
+        rect.size.width == 0.0f && rect.size.height == 0.0f;
+}
+
+inline bool PanZoomRectEqual(const PanZoomRect& a, const PanZoomRect& b)
+{
+    return a.origin.x == b.origin.x && a.origin.y == b.origin.y && 
+        a.size.width == b.size.width && a.size.height == b.size.height;
+}
+
+inline bool PanZoomRectIntersects(const PanZoomRect& a, const PanZoomRect& b)
+{
+    return !(a.origin.x + a.size.width < b.origin.x || b.origin.x + b.size.width < a.origin.x ||
+        a.origin.y + a.size.height < b.origin.y || b.origin.y + b.size.height < a.origin.y);
+}
+
+inline bool PanZoomRectContainsPoint(const PanZoomRect& rect, const PanZoomPoint& point)
+{
+    return point.x >= rect.origin.x && point.x <= rect.origin.x + rect.size.width &&
+        point.y >= rect.origin.y && point.y <= rect.origin.y + rect.size.height;
+}
+
+// Rect grown by margin on every side.
+inline PanZoomRect PanZoomRectOutset(const PanZoomRect& rect, float margin)
+{
+    return PanZoomRectMake(rect.origin.x - margin, rect.origin.y - margin, 
+        rect.size.width + 2.0f * margin, rect.size.height + 2.0f * margin);
+}
+
+
+// Range of layer positions that keep panBoundsRect covered. When the layer
+// is smaller than the bounds, min wins over max (layer sticks to top/right).
+struct PanZoomPositionLimits
+{
+    float minX;
+    float maxX;
+    float minY;
+    float maxY;
+};
+
+// Distances between the layer edges and panBoundsRect edges.
+struct PanZoomEdgeDistances
+{
+    float top;
+    float left;
+    float bottom;
+    float right;
+};
+
+
+// Shape of the frame mode scrolling speed across an edge margin, from 
+// minSpeed at its inner side to maxSpeed at the bounds.
+typedef enum
+{
+    kCCLayerPanZoomEdgeSpeedCurveLinear,
+    kCCLayerPanZoomEdgeSpeedCurveEaseIn,
+    kCCLayerPanZoomEdgeSpeedCurveEaseOut,
+    kCCLayerPanZoomEdgeSpeedCurveEaseInOut,
+    // Samples given to PanZoomFrameSettings::setCustomSpeedCurve.
+    kCCLayerPanZoomEdgeSpeedCurveCustom
+} CCLayerPanZoomEdgeSpeedCurve;
+
+// Segments of the precomputed edge speed table.
+#define kPanZoomEdgeSpeedTableSegments 32
+
+
+// Frame mode scrolling parameters.
+struct PanZoomFrameSettings
+{
+    float topMargin;
+    float bottomMargin;
+    float leftMargin;
+    float rightMargin;
+    float minSpeed;
+    float maxSpeed;
+    CCLayerPanZoomEdgeSpeedCurve speedCurve;
+    // Custom curve resampled to the table, 0 (minSpeed) to 1 (maxSpeed).
+    float customSpeedCurve[kPanZoomEdgeSpeedTableSegments + 1];
+
+    // Derived from the fields above by precompute(), call it after changing
+    // them.
+    float speedTable[kPanZoomEdgeSpeedTableSegments + 1];
+    float inverseTopMargin;
+    float inverseBottomMargin;
+    float inverseLeftMargin;
+    float inverseRightMargin;
+
+    void precompute();
+    // Sets a custom curve from count >= 2 samples spread evenly across the
+    // margin, 0 meaning minSpeed and 1 maxSpeed.
+    void setCustomSpeedCurve(const float* values, unsigned int count);
+    // Speed at depth 0 (inner side of the margin) to 1 (bounds). Past the
+    // bounds it is extrapolated from the last table segment.
+    float speedAtDepth(float depth) const;
+};
+
+
+// What changed in a CCLayerPanZoom, see CCLayerPanZoom::dirtyFlagsSinceVersion.
+typedef enum
+{
+    kCCLayerPanZoomDirtyNone = 0,
+    kCCLayerPanZoomDirtyPosition = 1 << 0,
+    kCCLayerPanZoomDirtyScale = 1 << 1,
+    // Pan bounds or content size.
+    kCCLayerPanZoomDirtyBounds = 1 << 2,
+    kCCLayerPanZoomDirtyMode = 1 << 3
+} CCLayerPanZoomDirtyFlag;
+
+#define kCCLayerPanZoomDirtyFlagCount 4
+
+// Change counter remembering the version of the last change of each
+// CCLayerPanZoomDirtyFlag.
+struct PanZoomTransformVersion
+{
+    PanZoomTransformVersion();
+
+    unsigned int version;
+    unsigned int dirtyVersions[kCCLayerPanZoomDirtyFlagCount];
+
+    // Starts a new version with dirtyFlags changed.
+    void markDirty(unsigned int dirtyFlags);
+    // CCLayerPanZoomDirtyFlag bits changed after sinceVersion.
+    unsigned int dirtyFlagsSince(unsigned int sinceVersion) const;
+};
+
+
+// Position, scale and limits of a pan/zoom layer.
+class PanZoomState
+{
+public:
+    PanZoomState();
+
+    // Node transform (mirrors CCNode).
+    PanZoomPoint position;
+    float scale;
+    PanZoomPoint anchorPoint;
+    PanZoomSize contentSize;
+    bool ignoreAnchorPointForPosition;
+
+    // Limits.
+    PanZoomRect panBoundsRect;
+    float minScale;
+    float maxScale;
+    float rubberEffectRatio;
+    CCLayerPanZoomMode mode;
+
+    bool hasPanBounds() const;
+
+    // Conversions between parent space and layer space. The layer's parent is
+    // treated as world (GL) space, like the rest of the math here does.
+    PanZoomPoint convertToNodeSpace(PanZoomPoint point) const;
+    PanZoomPoint convertToParentSpace(PanZoomPoint point) const;
+    // Batch conversions of n points stored as x, y pairs; out may be xy. 
+    // Uses SSE or NEON when the target has it, with the same results as the
+    // single point conversions.
+    void convertToNodeSpace(const float* xy, float* out, size_t n) const;
+    void convertToParentSpace(const float* xy, float* out, size_t n) const;
+    // Position showing nodePoint at parentPoint with the current scale.
+    PanZoomPoint positionForPoint(PanZoomPoint nodePoint, PanZoomPoint parentPoint) const;
+    // Part of the layer seen through viewport (in parent space), in layer space.
+    PanZoomRect visibleRect(const PanZoomRect& viewport) const;
+
+    // Scale limited by minScale/maxScale.
+    float clampScale(float scale) const;
+    // Minimal scale that keeps panBoundsRect covered, or minScale without bounds.
+    float minPossibleScale() const;
+
+    // Distances (in whole points) between the layer edges and panBoundsRect edges
+    // when the layer doesn't cover the bounds, 0 otherwise.
+    float topEdgeDistance() const;
+    float leftEdgeDistance() const;
+    float bottomEdgeDistance() const;
+    float rightEdgeDistance() const;
+
+    // All four edge distances computed from one set of scaled extents.
+    PanZoomEdgeDistances edgeDistances() const;
+
+    // Position limits for the current scale, anchor and bounds.
+    PanZoomPositionLimits positionLimits() const;
+    // Same for any scaled layer size, anchor point and bounds.
+    static PanZoomPositionLimits positionLimits(const PanZoomRect& panBoundsRect, 
+        PanZoomSize scaledSize, PanZoomPoint anchorPoint);
+    // Clamps a position to precomputed limits, e.g. to test many candidates.
+    static PanZoomPoint clampPosition(PanZoomPoint position, const PanZoomPositionLimits& limits);
+
+    // Position moved so that the layer covers panBoundsRect.
+    PanZoomPoint boundedPosition(PanZoomPoint position) const;
+
+    // Position the layer ends up at when moved from prevPosition to position:
+    // clamped to panBoundsRect or slowed down by the rubber effect.
+    PanZoomPoint constrainedPosition(PanZoomPoint prevPosition, PanZoomPoint position,
+        bool rubberEffectRecovering) const;
+
+private:
+    // Parent <-> node transform cached for the transform inputs it was built
+    // from, rebuilt only when position, scale, anchor or content size change.
+    struct NodeTransform
+    {
+        bool valid;
+        PanZoomPoint position;
+        float scale;
+        PanZoomPoint anchorPoint;
+        PanZoomSize contentSize;
+        bool ignoreAnchorPointForPosition;
+
+        // node = parent * inverseScale + toNodeOffset
+        float inverseScale;
+        PanZoomPoint toNodeOffset;
+        // parent = node * scale + toParentOffset
+        PanZoomPoint toParentOffset;
+    };
+    mutable NodeTransform _nodeTransform;
+
+    const NodeTransform& nodeTransform() const;
+};
+
+
+// Frame mode helpers.
+// Classifies point and sets the scrolling velocity of the layer in one pass.
+CCLayerPanZoomFrameEdge PanZoomFrameEdgeVelocity(const PanZoomRect& panBoundsRect, 
+    const PanZoomFrameSettings& settings, PanZoomPoint point, PanZoomPoint& velocity);
+CCLayerPanZoomFrameEdge PanZoomFrameEdgeWithPoint(const PanZoomRect& panBoundsRect, 
+    const PanZoomFrameSettings& settings, PanZoomPoint point);
+float PanZoomHorSpeedWithPosition(const PanZoomRect& panBoundsRect, 
+    const PanZoomFrameSettings& settings, PanZoomPoint pos);
+float PanZoomVertSpeedWithPosition(const PanZoomRect& panBoundsRect, 
+    const PanZoomFrameSettings& settings, PanZoomPoint pos);
+
+#endif // __PANZOOM_STATE_H__
@@ -0,0 +1,160 @@
+/*
+* CCLayerPanZoom
+*
+* Copyright (c) 2011 Alexey Lang
+* Copyright (c) 2011 Pavel Guganov
+*
+* http://www.cocos2d-x.org
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*
+*/
+
+
+#include "PanZoomStats.h"
+
+#if CC_PANZOOM_ENABLE_STATS
+
+#include <string.h>
+
+PanZoomStats::PanZoomStats()
+{
+    this->reset();
+}
+
+void PanZoomStats::reset()
+{
+    memset(&_frame, 0, sizeof(_frame));
+    memset(&_lastFrame, 0, sizeof(_lastFrame));
+    memset(&_totals, 0, sizeof(_totals));
+    _frameCount = 0;
+    _historyHead = 0;
+    _historyCount = 0;
+}
+
+void PanZoomStats::endFrame()
+{
+    for (int i = 0; i < kPanZoomStatCount; ++i)
+    {
+        _totals.counts[i] += _frame.counts[i];
+    }
+    for (int i = 0; i < kPanZoomTimerCount; ++i)
+    {
+        _totals.times[i] += _frame.times[i];
+    }
+    ++_frameCount;
+
+    _history[_historyHead] = _frame;
+    _historyHead = (_historyHead + 1) % kPanZoomStatsHistory;
+    if (_historyCount < kPanZoomStatsHistory)
+    {
+        ++_historyCount;
+    }
+
+    _lastFrame = _frame;
+    memset(&_frame, 0, sizeof(_frame));
+}
+
+const PanZoomFrameStats& PanZoomStats::historyFrame(unsigned int index) const
+{
+    return _history[(_historyHead + kPanZoomStatsHistory - _historyCount + index) % kPanZoomStatsHistory];
+}
+
+const char* PanZoomStats::statName(PanZoomStat stat)
+{
+    switch (stat)
+    {
+    case kPanZoomStatTouchEvents: return "touchEvents";
+    case kPanZoomStatClamps: return "clamps";
+    case kPanZoomStatRecoveriesStarted: return "recoveriesStarted";
+    case kPanZoomStatChildrenCulled: return "childrenCulled";
+    default: return "";
+    }
+}
+
+const char* PanZoomStats::timerName(PanZoomTimer timer)
+{
+    switch (timer)
+    {
+    case kPanZoomTimerTouchesMoved: return "touchesMovedUs";
+    case kPanZoomTimerUpdate: return "updateUs";
+    case kPanZoomTimerSetPosition: return "setPositionUs";
+    default: return "";
+    }
+}
+
+void PanZoomStats::writeCSV(FILE* file) const
+{
+    fprintf(file, "frame");
+    for (int i = 0; i < kPanZoomStatCount; ++i)
+    {
+        fprintf(file, ",%s", PanZoomStats::statName((PanZoomStat)i));
+    }
+    for (int i = 0; i < kPanZoomTimerCount; ++i)
+    {
+        fprintf(file, ",%s", PanZoomStats::timerName((PanZoomTimer)i));
+    }
+    fprintf(file, "\n");
+
+    for (unsigned int frame = 0; frame < _historyCount; ++frame)
+    {
+        const PanZoomFrameStats& stats = this->historyFrame(frame);
+        fprintf(file, "%u", _frameCount - _historyCount + frame);
+        for (int i = 0; i < kPanZoomStatCount; ++i)
+        {
+            fprintf(file, ",%u", stats.counts[i]);
+        }
+        for (int i = 0; i < kPanZoomTimerCount; ++i)
+        {
+            fprintf(file, ",%.2f", stats.times[i] * 1.0e6);
+        }
+        fprintf(file, "\n");
+    }
+}
+
+static void PanZoomWriteJSONFrame(FILE* file, const PanZoomFrameStats& stats, double divisor)
+{
+    fprintf(file, "{");
+    for (int i = 0; i < kPanZoomStatCount; ++i)
+    {
+        fprintf(file, "%s\"%s\": %.3f", i ? ", " : "", PanZoomStats::statName((PanZoomStat)i), stats.counts[i] / divisor);
+    }
+    for (int i = 0; i < kPanZoomTimerCount; ++i)
+    {
+        fprintf(file, ", \"%s\": %.2f", PanZoomStats::timerName((PanZoomTimer)i), stats.times[i] * 1.0e6 / divisor);
+    }
+    fprintf(file, "}");
+}
+
+void PanZoomStats::writeJSON(FILE* file) const
+{
+    fprintf(file, "{\n  \"frames\": %u,\n  \"totals\": ", _frameCount);
+    PanZoomWriteJSONFrame(file, _totals, 1.0);
+    fprintf(file, ",\n  \"perFrame\": ");
+    PanZoomWriteJSONFrame(file, _totals, _frameCount ? (double)_frameCount : 1.0);
+    fprintf(file, ",\n  \"history\": [");
+    for (unsigned int frame = 0; frame < _historyCount; ++frame)
+    {
+        fprintf(file, "%s\n    ", frame ? "," : "");
+        PanZoomWriteJSONFrame(file, this->historyFrame(frame), 1.0);
+    }
+    fprintf(file, "\n  ]\n}\n");
+}
+
+#endif // CC_PANZOOM_ENABLE_STATS
@@ -0,0 +1,141 @@
+/*
+* CCLayerPanZoom
+*
+* Copyright (c) 2011 Alexey Lang
+* Copyright (c) 2011 Pavel Guganov
+*
+* http://www.cocos2d-x.org
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*
+*/
+
+
+#ifndef __PANZOOM_STATS_H__
+#define __PANZOOM_STATS_H__
+
+// Gesture counters and timers. They are compiled in debug builds 
+// (COCOS2D_DEBUG > 0) only, define CC_PANZOOM_ENABLE_STATS to 1 or 0 to 
+// choose. Without them the CC_PANZOOM_STATS_* macros expand to nothing.
+#ifndef CC_PANZOOM_ENABLE_STATS
+#if defined(COCOS2D_DEBUG) && COCOS2D_DEBUG > 0
+#define CC_PANZOOM_ENABLE_STATS 1
+#else
+#define CC_PANZOOM_ENABLE_STATS 0
+#endif
+#endif
+
+#if CC_PANZOOM_ENABLE_STATS
+
+#include "PanZoomClock.h"
+
+#include <stdio.h>
+
+// Frames kept for dumps.
+#define kPanZoomStatsHistory 120
+
+enum PanZoomStat
+{
+    kPanZoomStatTouchEvents,
+    kPanZoomStatClamps,
+    kPanZoomStatRecoveriesStarted,
+    kPanZoomStatChildrenCulled,
+    kPanZoomStatCount
+};
+
+enum PanZoomTimer
+{
+    kPanZoomTimerTouchesMoved,
+    kPanZoomTimerUpdate,
+    kPanZoomTimerSetPosition,
+    kPanZoomTimerCount
+};
+
+struct PanZoomFrameStats
+{
+    unsigned int counts[kPanZoomStatCount];
+    // Seconds.
+    double times[kPanZoomTimerCount];
+};
+
+class PanZoomStats
+{
+public:
+    PanZoomStats();
+
+    void count(PanZoomStat stat, unsigned int n) { _frame.counts[stat] += n; }
+    void addTime(PanZoomTimer timer, double seconds) { _frame.times[timer] += seconds; }
+    // Closes the current frame.
+    void endFrame();
+    void reset();
+
+    const PanZoomFrameStats& currentFrame() const { return _frame; }
+    const PanZoomFrameStats& lastFrame() const { return _lastFrame; }
+    // Sums over all closed frames.
+    const PanZoomFrameStats& totals() const { return _totals; }
+    unsigned int frameCount() const { return _frameCount; }
+    // Kept frames, 0 is the oldest.
+    unsigned int historyCount() const { return _historyCount; }
+    const PanZoomFrameStats& historyFrame(unsigned int index) const;
+
+    // One row per kept frame, times in microseconds.
+    void writeCSV(FILE* file) const;
+    // Totals, per frame averages and kept frames, times in microseconds.
+    void writeJSON(FILE* file) const;
+
+    static const char* statName(PanZoomStat stat);
+    static const char* timerName(PanZoomTimer timer);
+
+private:
+    PanZoomFrameStats _frame;
+    PanZoomFrameStats _lastFrame;
+    PanZoomFrameStats _totals;
+    unsigned int _frameCount;
+    PanZoomFrameStats _history[kPanZoomStatsHistory];
+    unsigned int _historyHead;
+    unsigned int _historyCount;
+};
+
+// Adds the time until the end of the scope to a timer.
+class PanZoomScopedTimer
+{
+public:
+    PanZoomScopedTimer(PanZoomStats& stats, PanZoomTimer timer)
+        : _stats(stats), _timer(timer), _start(PanZoomMonotonicTime()) {}
+    ~PanZoomScopedTimer() { _stats.addTime(_timer, PanZoomMonotonicTime() - _start); }
+
+private:
+    PanZoomStats& _stats;
+    PanZoomTimer _timer;
+    double _start;
+};
+
+#define CC_PANZOOM_STATS_COUNT(stats, stat, n) (stats).count(stat, n)
+#define CC_PANZOOM_STATS_TIME(stats, timer) PanZoomScopedTimer panZoomScopedTimer(stats, timer)
+#define CC_PANZOOM_STATS_END_FRAME(stats) (stats).endFrame()
+
+#else
+
+#define CC_PANZOOM_STATS_COUNT(stats, stat, n) ((void)0)
+#define CC_PANZOOM_STATS_TIME(stats, timer) ((void)0)
+#define CC_PANZOOM_STATS_END_FRAME(stats) ((void)0)
+
+#endif // CC_PANZOOM_ENABLE_STATS
+
+#endif // __PANZOOM_STATS_H__
@@ -0,0 +1,143 @@
+/*
+* CCLayerPanZoom
+*
+* Copyright (c) 2011 Alexey Lang
+* Copyright (c) 2011 Pavel Guganov
+*
+* http://www.cocos2d-x.org
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*
+*/
+
+
+#include "PanZoomTileCache.h"
+
+#include <stddef.h>
+
+PanZoomTileCache::PanZoomTileCache()
+    : _budget(0),
+      _memoryUsage(0),
+      _hits(0),
+      _misses(0),
+      _evictions(0)
+{
+}
+
+void* PanZoomTileCache::get(const PanZoomTileKey& key)
+{
+    std::map<PanZoomTileKey, TileList::iterator>::iterator found = _index.find(key);
+    if (found == _index.end())
+    {
+        ++_misses;
+        return NULL;
+    }
+    ++_hits;
+    _tiles.splice(_tiles.begin(), _tiles, found->second);
+    return found->second->tile;
+}
+
+bool PanZoomTileCache::contains(const PanZoomTileKey& key) const
+{
+    return _index.find(key) != _index.end();
+}
+
+void* PanZoomTileCache::insert(const PanZoomTileKey& key, void* tile, unsigned int memorySize)
+{
+    std::map<PanZoomTileKey, TileList::iterator>::iterator found = _index.find(key);
+    if (found != _index.end())
+    {
+        PanZoomCachedTile& cached = *found->second;
+        void* replaced = cached.tile;
+        _memoryUsage = _memoryUsage - cached.memorySize + memorySize;
+        cached.tile = tile;
+        cached.memorySize = memorySize;
+        _tiles.splice(_tiles.begin(), _tiles, found->second);
+        return replaced;
+    }
+
+    PanZoomCachedTile cached;
+    cached.key = key;
+    cached.tile = tile;
+    cached.memorySize = memorySize;
+    cached.pinned = false;
+    _tiles.push_front(cached);
+    _index[key] = _tiles.begin();
+    _memoryUsage += memorySize;
+    return NULL;
+}
+
+void PanZoomTileCache::setPinned(const PanZoomTileKey& key, bool pinned)
+{
+    std::map<PanZoomTileKey, TileList::iterator>::iterator found = _index.find(key);
+    if (found != _index.end())
+    {
+        found->second->pinned = pinned;
+    }
+}
+
+void PanZoomTileCache::unpinAll()
+{
+    for (TileList::iterator tile = _tiles.begin(); tile != _tiles.end(); ++tile)
+    {
+        tile->pinned = false;
+    }
+}
+
+void PanZoomTileCache::evict(std::vector<void*>& evicted)
+{
+    TileList::iterator tile = _tiles.end();
+    while (_memoryUsage > _budget && tile != _tiles.begin())
+    {
+        --tile;
+        if (tile->pinned)
+        {
+            continue;
+        }
+        evicted.push_back(tile->tile);
+        _memoryUsage -= tile->memorySize;
+        _index.erase(tile->key);
+        tile = _tiles.erase(tile);
+        ++_evictions;
+    }
+}
+
+void PanZoomTileCache::clear(std::vector<void*>& removed)
+{
+    for (TileList::iterator tile = _tiles.begin(); tile != _tiles.end(); ++tile)
+    {
+        removed.push_back(tile->tile);
+    }
+    _tiles.clear();
+    _index.clear();
+    _memoryUsage = 0;
+}
+
+float PanZoomTileCache::hitRate() const
+{
+    unsigned int lookups = _hits + _misses;
+    return lookups ? (float)_hits / lookups : 0.0f;
+}
+
+void PanZoomTileCache::resetStatistics()
+{
+    _hits = 0;
+    _misses = 0;
+    _evictions = 0;
+}
@@ -0,0 +1,98 @@
+/*
+* CCLayerPanZoom
+*
+* Copyright (c) 2011 Alexey Lang
+* Copyright (c) 2011 Pavel Guganov
+*
+* http://www.cocos2d-x.org
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*
+*/
+
+
+#ifndef __PANZOOM_TILE_CACHE_H__
+#define __PANZOOM_TILE_CACHE_H__
+
+#include "PanZoomTiling.h"
+
+#include <list>
+#include <map>
+#include <vector>
+
+struct PanZoomCachedTile
+{
+    PanZoomTileKey key;
+    // Owner's tile object, e.g. the tile node.
+    void* tile;
+    unsigned int memorySize;
+    bool pinned;
+};
+
+// Least recently used cache of tiles under a byte budget. Pinned tiles, e.g.
+// the visible ones, are never evicted, so the budget may be exceeded while
+// they alone don't fit. Evicted tiles are handed back to the owner to free.
+class PanZoomTileCache
+{
+public:
+    typedef std::list<PanZoomCachedTile> TileList;
+
+    PanZoomTileCache();
+
+    void setBudget(unsigned int budget) { _budget = budget; }
+    unsigned int budget() const { return _budget; }
+    unsigned int memoryUsage() const { return _memoryUsage; }
+    unsigned int count() const { return (unsigned int)_index.size(); }
+
+    // Tile for key made the most recently used one, or NULL. Counts a hit or
+    // a miss.
+    void* get(const PanZoomTileKey& key);
+    bool contains(const PanZoomTileKey& key) const;
+    // Adds a tile as the most recently used one. A tile already cached for 
+    // key is replaced (keeping its pin) and returned for the owner to free,
+    // otherwise returns NULL.
+    void* insert(const PanZoomTileKey& key, void* tile, unsigned int memorySize);
+    void setPinned(const PanZoomTileKey& key, bool pinned);
+    void unpinAll();
+    // Removes least recently used unpinned tiles until the usage fits the 
+    // budget and appends them to evicted.
+    void evict(std::vector<void*>& evicted);
+    // Removes all tiles and appends them to removed.
+    void clear(std::vector<void*>& removed);
+    // Most recently used first.
+    const TileList& tiles() const { return _tiles; }
+
+    unsigned int hits() const { return _hits; }
+    unsigned int misses() const { return _misses; }
+    unsigned int evictions() const { return _evictions; }
+    // Hits per lookup, 0 without lookups.
+    float hitRate() const;
+    void resetStatistics();
+
+private:
+    TileList _tiles;
+    std::map<PanZoomTileKey, TileList::iterator> _index;
+    unsigned int _budget;
+    unsigned int _memoryUsage;
+    unsigned int _hits;
+    unsigned int _misses;
+    unsigned int _evictions;
+};
+
+#endif // __PANZOOM_TILE_CACHE_H__
@@ -0,0 +1,211 @@
+/*
+* CCLayerPanZoom
+*
+* Copyright (c) 2011 Alexey Lang
+* Copyright (c) 2011 Pavel Guganov
+*
+* http://www.cocos2d-x.org
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*
+*/
+
+
+#include "PanZoomTileLoader.h"
+
+#include <stddef.h>
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+PanZoomStubTileDecoder::PanZoomStubTileDecoder(unsigned int tileSize, double delay)
+    : _tileSize(tileSize),
+      _delay(delay)
+{
+}
+
+bool PanZoomStubTileDecoder::decode(const PanZoomTileKey& key, PanZoomTileImage& image)
+{
+    if (_delay > 0.0)
+    {
+#if defined(_WIN32)
+        Sleep((DWORD)(_delay * 1000.0));
+#else
+        usleep((useconds_t)(_delay * 1000000.0));
+#endif
+    }
+    image.width = _tileSize;
+    image.height = _tileSize;
+    image.pixels.resize(_tileSize * _tileSize * 4);
+    unsigned char r = (unsigned char)(key.x * 40);
+    unsigned char g = (unsigned char)(key.y * 40);
+    unsigned char b = (unsigned char)(key.level * 60);
+    for (size_t i = 0; i < image.pixels.size(); i += 4)
+    {
+        image.pixels[i] = r;
+        image.pixels[i + 1] = g;
+        image.pixels[i + 2] = b;
+        image.pixels[i + 3] = 255;
+    }
+    return true;
+}
+
+PanZoomTileLoader::PanZoomTileLoader(PanZoomTileDecoder* decoder, int threadCount)
+    : _decoder(decoder),
+      _stopping(false)
+{
+    pthread_mutex_init(&_mutex, NULL);
+    pthread_cond_init(&_wanted, NULL);
+    for (int i = 0; i < threadCount; ++i)
+    {
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, &PanZoomTileLoader::workerMain, this) == 0)
+        {
+            _threads.push_back(thread);
+        }
+    }
+}
+
+PanZoomTileLoader::~PanZoomTileLoader()
+{
+    pthread_mutex_lock(&_mutex);
+    _stopping = true;
+    _queue.clear();
+    pthread_cond_broadcast(&_wanted);
+    pthread_mutex_unlock(&_mutex);
+    for (size_t i = 0; i < _threads.size(); ++i)
+    {
+        pthread_join(_threads[i], NULL);
+    }
+
+    for (size_t i = 0; i < _results.size(); ++i)
+    {
+        delete _results[i];
+    }
+    pthread_cond_destroy(&_wanted);
+    pthread_mutex_destroy(&_mutex);
+}
+
+void PanZoomTileLoader::setWanted(const std::vector<PanZoomTileKey>& tiles)
+{
+    pthread_mutex_lock(&_mutex);
+    _queue.clear();
+    for (size_t i = tiles.size(); i > 0; --i)
+    {
+        if (_busy.find(tiles[i - 1]) == _busy.end())
+        {
+            _queue.push_back(tiles[i - 1]);
+        }
+    }
+    if (!_queue.empty())
+    {
+        pthread_cond_broadcast(&_wanted);
+    }
+    pthread_mutex_unlock(&_mutex);
+}
+
+bool PanZoomTileLoader::popDecoded(PanZoomTileKey& key, PanZoomTileImage& image, bool& ok)
+{
+    if (_threads.empty())
+    {
+        PanZoomTileKey queued;
+        if (this->takeQueued(queued, false))
+        {
+            PanZoomTileImage decoded;
+            bool decodedOk = _decoder->decode(queued, decoded);
+            this->addResult(queued, decoded, decodedOk);
+        }
+    }
+
+    pthread_mutex_lock(&_mutex);
+    bool popped = !_results.empty();
+    if (popped)
+    {
+        Result* result = _results.front();
+        _results.pop_front();
+        _busy.erase(result->key);
+        key = result->key;
+        image.width = result->image.width;
+        image.height = result->image.height;
+        image.pixels.swap(result->image.pixels);
+        ok = result->ok;
+        delete result;
+    }
+    pthread_mutex_unlock(&_mutex);
+    return popped;
+}
+
+unsigned int PanZoomTileLoader::pendingCount()
+{
+    pthread_mutex_lock(&_mutex);
+    unsigned int count = (unsigned int)(_queue.size() + _busy.size() - _results.size());
+    pthread_mutex_unlock(&_mutex);
+    return count;
+}
+
+void* PanZoomTileLoader::workerMain(void* loader)
+{
+    ((PanZoomTileLoader*)loader)->work();
+    return NULL;
+}
+
+void PanZoomTileLoader::work()
+{
+    PanZoomTileKey key;
+    while (this->takeQueued(key, true))
+    {
+        PanZoomTileImage image;
+        bool ok = _decoder->decode(key, image);
+        this->addResult(key, image, ok);
+    }
+}
+
+bool PanZoomTileLoader::takeQueued(PanZoomTileKey& key, bool wait)
+{
+    pthread_mutex_lock(&_mutex);
+    while (wait && !_stopping && _queue.empty())
+    {
+        pthread_cond_wait(&_wanted, &_mutex);
+    }
+    bool taken = !_stopping && !_queue.empty();
+    if (taken)
+    {
+        key = _queue.back();
+        _queue.pop_back();
+        _busy.insert(key);
+    }
+    pthread_mutex_unlock(&_mutex);
+    return taken;
+}
+
+void PanZoomTileLoader::addResult(const PanZoomTileKey& key, PanZoomTileImage& image, bool ok)
+{
+    Result* result = new Result();
+    result->key = key;
+    result->image.width = image.width;
+    result->image.height = image.height;
+    result->image.pixels.swap(image.pixels);
+    result->ok = ok;
+
+    pthread_mutex_lock(&_mutex);
+    _results.push_back(result);
+    pthread_mutex_unlock(&_mutex);
+}
@@ -0,0 +1,117 @@
+/*
+* CCLayerPanZoom
+*
+* Copyright (c) 2011 Alexey Lang
+* Copyright (c) 2011 Pavel Guganov
+*
+* http://www.cocos2d-x.org
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*
+*/
+
+
+#ifndef __PANZOOM_TILE_LOADER_H__
+#define __PANZOOM_TILE_LOADER_H__
+
+#include "PanZoomTiling.h"
+
+#include <pthread.h>
+#include <deque>
+#include <set>
+#include <vector>
+
+// Decoded tile pixels, RGBA8888.
+struct PanZoomTileImage
+{
+    unsigned int width;
+    unsigned int height;
+    std::vector<unsigned char> pixels;
+};
+
+// Decodes tiles into CPU memory. Called from the loader worker threads, so 
+// implementations must not touch GL or other main thread state.
+class PanZoomTileDecoder
+{
+public:
+    virtual ~PanZoomTileDecoder() {}
+    virtual bool decode(const PanZoomTileKey& key, PanZoomTileImage& image) = 0;
+};
+
+// Decoder stub for headless runs: solid tiles colored by key, optionally 
+// taking delay seconds per tile to stand in for file decoding.
+class PanZoomStubTileDecoder : public PanZoomTileDecoder
+{
+public:
+    PanZoomStubTileDecoder(unsigned int tileSize, double delay);
+    virtual bool decode(const PanZoomTileKey& key, PanZoomTileImage& image);
+
+private:
+    unsigned int _tileSize;
+    double _delay;
+};
+
+// Decodes wanted tiles on a pool of worker threads, most urgent first. The
+// owner sets the wanted tiles and collects decoded ones on its own thread.
+// With no threads tiles are decoded one at a time in popDecoded(), which 
+// keeps headless runs deterministic.
+class PanZoomTileLoader
+{
+public:
+    // The decoder isn't retained and must outlive the loader.
+    PanZoomTileLoader(PanZoomTileDecoder* decoder, int threadCount);
+    ~PanZoomTileLoader();
+
+    // Replaces the queue with tiles, most urgent first. Tiles already being
+    // decoded or decoded and not popped yet are skipped; queued tiles missing
+    // from the list are dropped.
+    void setWanted(const std::vector<PanZoomTileKey>& tiles);
+    // Takes a decoded tile, false when there is none. ok is false when the
+    // decoder failed.
+    bool popDecoded(PanZoomTileKey& key, PanZoomTileImage& image, bool& ok);
+    // Tiles queued or being decoded.
+    unsigned int pendingCount();
+
+private:
+    struct Result
+    {
+        PanZoomTileKey key;
+        PanZoomTileImage image;
+        bool ok;
+    };
+
+    static void* workerMain(void* loader);
+    void work();
+    bool takeQueued(PanZoomTileKey& key, bool wait);
+    void addResult(const PanZoomTileKey& key, PanZoomTileImage& image, bool ok);
+
+    PanZoomTileDecoder* _decoder;
+    std::vector<pthread_t> _threads;
+    pthread_mutex_t _mutex;
+    pthread_cond_t _wanted;
+    bool _stopping;
+    // Queue in reverse order, the most urgent tile at the back.
+    std::vector<PanZoomTileKey> _queue;
+    // Tiles being decoded or decoded and not popped yet.
+    std::set<PanZoomTileKey> _busy;
+    // Decoded tiles in the order they finished.
+    std::deque<Result*> _results;
+};
+
+#endif // __PANZOOM_TILE_LOADER_H__
@@ -0,0 +1,133 @@
+/*
+* CCLayerPanZoom
+*
+* Copyright (c) 2011 Alexey Lang
+* Copyright (c) 2011 Pavel Guganov
+*
+* http://www.cocos2d-x.org
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*
+*/
+
+
+#include "PanZoomTiling.h"
+
+#include <algorithm>
+
+#ifndef MIN
+#define MIN(x,y) (((x) > (y)) ? (y) : (x))
+#endif
+#ifndef MAX
+#define MAX(x,y) (((x) < (y)) ? (y) : (x))
+#endif
+
+struct PanZoomTileNearer
+{
+    const PanZoomTiling* tiling;
+    PanZoomPoint point;
+
+    float distance(const PanZoomTileKey& key) const
+    {
+        PanZoomRect rect = tiling->tileRect(key);
+        float dx = rect.origin.x + rect.size.width * 0.5f - point.x;
+        float dy = rect.origin.y + rect.size.height * 0.5f - point.y;
+        return dx * dx + dy * dy;
+    }
+
+    bool operator()(const PanZoomTileKey& a, const PanZoomTileKey& b) const
+    {
+        return this->distance(a) < this->distance(b);
+    }
+};
+
+PanZoomTiling::PanZoomTiling()
+    : contentSize(PanZoomSizeMake(0.0f, 0.0f)),
+      tileSize(256.0f),
+      levelCount(1)
+{
+}
+
+int PanZoomTiling::levelForScale(float scale) const
+{
+    int level = 0;
+    float levelScale = 0.5f;
+    while (level + 1 < levelCount && scale <= levelScale)
+    {
+        ++level;
+        levelScale *= 0.5f;
+    }
+    return level;
+}
+
+float PanZoomTiling::tileContentSize(int level) const
+{
+    return ldexpf(tileSize, level);
+}
+
+int PanZoomTiling::columnCount(int level) const
+{
+    return (int)ceilf(contentSize.width / this->tileContentSize(level));
+}
+
+int PanZoomTiling::rowCount(int level) const
+{
+    return (int)ceilf(contentSize.height / this->tileContentSize(level));
+}
+
+PanZoomRect PanZoomTiling::tileRect(const PanZoomTileKey& key) const
+{
+    float size = this->tileContentSize(key.level);
+    float x = key.x * size;
+    float y = key.y * size;
+    return PanZoomRectMake(x, y, MIN(size, contentSize.width - x), MIN(size, contentSize.height - y));
+}
+
+void PanZoomTiling::tilesInRect(const PanZoomRect& rect, int level, std::vector<PanZoomTileKey>& result) const
+{
+    float size = this->tileContentSize(level);
+    float left = MAX(rect.origin.x, 0.0f);
+    float bottom = MAX(rect.origin.y, 0.0f);
+    float right = MIN(rect.origin.x + rect.size.width, contentSize.width);
+    float top = MIN(rect.origin.y + rect.size.height, contentSize.height);
+    if (left >= right || bottom >= top)
+    {
+        return;
+    }
+
+    int minX = (int)floorf(left / size);
+    int maxX = MIN((int)ceilf(right / size), this->columnCount(level)) - 1;
+    int minY = (int)floorf(bottom / size);
+    int maxY = MIN((int)ceilf(top / size), this->rowCount(level)) - 1;
+    for (int y = minY; y <= maxY; ++y)
+    {
+        for (int x = minX; x <= maxX; ++x)
+        {
+            result.push_back(PanZoomTileKeyMake(level, x, y));
+        }
+    }
+}
+
+void PanZoomTiling::sortTilesByDistance(std::vector<PanZoomTileKey>& tiles, const PanZoomPoint& point) const
+{
+    PanZoomTileNearer nearer;
+    nearer.tiling = this;
+    nearer.point = point;
+    std::sort(tiles.begin(), tiles.end(), nearer);
+}
@@ -0,0 +1,104 @@
+/*
+* CCLayerPanZoom
+*
+* Copyright (c) 2011 Alexey Lang
+* Copyright (c) 2011 Pavel Guganov
+*
+* http://www.cocos2d-x.org
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*
+*/
+
+
+#ifndef __PANZOOM_TILING_H__
+#define __PANZOOM_TILING_H__
+
+#include "PanZoomState.h"
+
+#include <vector>
+
+// Tile (level, x, y). Level 0 is full resolution, each level above halves it.
+struct PanZoomTileKey
+{
+    int level;
+    int x;
+    int y;
+};
+
+inline PanZoomTileKey PanZoomTileKeyMake(int level, int x, int y)
+{
+    PanZoomTileKey key;
+    key.level = level;
+    key.x = x;
+    key.y = y;
+    return key;
+}
+
+inline bool PanZoomTileKeyEqual(const PanZoomTileKey& a, const PanZoomTileKey& b)
+{
+    return a.level == b.level && a.x == b.x && a.y == b.y;
+}
+
+inline bool operator==(const PanZoomTileKey& a, const PanZoomTileKey& b)
+{
+    return PanZoomTileKeyEqual(a, b);
+}
+
+inline bool operator<(const PanZoomTileKey& a, const PanZoomTileKey& b)
+{
+    if (a.level != b.level)
+    {
+        return a.level < b.level;
+    }
+    if (a.y != b.y)
+    {
+        return a.y < b.y;
+    }
+    return a.x < b.x;
+}
+
+// Splits content into square tiles of tileSize pixels at levelCount levels 
+// of detail. A pixel of level 0 covers one point of content, so a tile of 
+// level L covers tileSize * 2^L points.
+class PanZoomTiling
+{
+public:
+    PanZoomTiling();
+
+    PanZoomSize contentSize;
+    float tileSize;
+    int levelCount;
+
+    // Coarsest level that still has at least one pixel per screen pixel.
+    int levelForScale(float scale) const;
+    // Points of content covered by a tile side at level.
+    float tileContentSize(int level) const;
+    int columnCount(int level) const;
+    int rowCount(int level) const;
+    // Content covered by the tile, smaller than tileContentSize() at the 
+    // right and top edges.
+    PanZoomRect tileRect(const PanZoomTileKey& key) const;
+    // Appends tiles of level intersecting rect (in content space).
+    void tilesInRect(const PanZoomRect& rect, int level, std::vector<PanZoomTileKey>& result) const;
+    // Sorts tiles by distance of their centers to point, nearest first.
+    void sortTilesByDistance(std::vector<PanZoomTileKey>& tiles, const PanZoomPoint& point) const;
+};
+
+#endif // __PANZOOM_TILING_H__
@@ -0,0 +1,468 @@
+/*
+* CCLayerPanZoom
+*
+* Copyright (c) 2011 Alexey Lang
+* Copyright (c) 2011 Pavel Guganov
+*
+* http://www.cocos2d-x.org
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*
+*/
+
+
+#include "PanZoomTrace.h"
+
+#include <string.h>
+
+#define kPanZoomTraceMagic "PZT3"
+// Written after the magic; reads back differently on a host of the other
+// byte order, whose traces are rejected.
+#define kPanZoomTraceByteOrder 0x01020304u
+
+// Record types after the event phases.
+enum
+{
+    kPanZoomTraceRecordState = kPanZoomTouchFrame + 1,
+    kPanZoomTraceRecordTransform
+};
+
+PanZoomTracePlayer::PanZoomTracePlayer(PanZoomController& controller)
+    : _controller(controller),
+      _previousClock(controller.clock)
+{
+    _controller.clock = &_clock;
+}
+
+PanZoomTracePlayer::~PanZoomTracePlayer()
+{
+    _controller.clock = _previousClock;
+}
+
+bool PanZoomTracePlayer::play(const PanZoomTouchEvent& event)
+{
+    _clock.setTime(event.time);
+
+    // Same steps as the corresponding CCLayerPanZoom handlers.
+    switch (event.phase)
+    {
+    case kPanZoomTouchBegan:
+        _controller.addTouch(event.touchId, event.position);
+        if (event.lastInBatch)
+        {
+            _controller.touchesBegan();
+        }
+        break;
+
+    case kPanZoomTouchMoved:
+        _controller.moveTouch(event.touchId, event.position);
+        if (event.lastInBatch)
+        {
+            _controller.touchesMoved();
+        }
+        break;
+
+    case kPanZoomTouchEnded:
+        _controller.removeTouch(event.touchId);
+        if (event.lastInBatch)
+        {
+            _controller.touchesEnded();
+        }
+        break;
+
+    case kPanZoomTouchCancelled:
+        _controller.removeTouch(event.touchId);
+        if (event.lastInBatch)
+        {
+            _controller.touchesCancelled();
+        }
+        break;
+
+    case kPanZoomTouchFrame:
+        _controller.update(event.dt);
+        break;
+    }
+    return event.lastInBatch;
+}
+
+PanZoomTraceSettings::PanZoomTraceSettings()
+{
+    this->copyFrom(PanZoomController());
+}
+
+void PanZoomTraceSettings::copyFrom(const PanZoomController& controller)
+{
+    frameSettings = controller.frameSettings;
+    maxTouchDistanceToClick = controller.maxTouchDistanceToClick;
+    coalesceTouches = controller.coalesceTouches;
+    rotationEnabled = controller.rotationEnabled;
+    rubberEffectRecoveryTime = controller.rubberEffectRecoveryTime;
+    flingEnabled = controller.flingEnabled;
+    flingFriction = controller.flingFriction;
+    flingMinVelocity = controller.flingMinVelocity;
+    predictionTime = controller.predictionTime;
+}
+
+void PanZoomTraceSettings::applyTo(PanZoomController& controller) const
+{
+    controller.frameSettings = frameSettings;
+    controller.maxTouchDistanceToClick = maxTouchDistanceToClick;
+    controller.coalesceTouches = coalesceTouches;
+    controller.rotationEnabled = rotationEnabled;
+    controller.rubberEffectRecoveryTime = rubberEffectRecoveryTime;
+    controller.flingEnabled = flingEnabled;
+    controller.flingFriction = flingFriction;
+    controller.flingMinVelocity = flingMinVelocity;
+    controller.predictionTime = predictionTime;
+}
+
+// Settings record fields, floats then flags.
+#define kPanZoomTraceSettingsFloats (11 + kPanZoomEdgeSpeedTableSegments + 1)
+#define kPanZoomTraceSettingsFlags 3
+
+PanZoomTraceWriter::PanZoomTraceWriter()
+    : _file(NULL),
+      _failed(false),
+      _used(0)
+{
+}
+
+PanZoomTraceWriter::~PanZoomTraceWriter()
+{
+    this->close();
+}
+
+bool PanZoomTraceWriter::open(const char* path, const PanZoomController& controller)
+{
+    this->close();
+    _file = fopen(path, "wb");
+    _failed = false;
+    if (!_file)
+    {
+        return false;
+    }
+
+    const PanZoomState& state = controller.state;
+    float values[] = {
+        state.position.x, state.position.y, state.scale, 
+        state.anchorPoint.x, state.anchorPoint.y, 
+        state.contentSize.width, state.contentSize.height,
+        state.panBoundsRect.origin.x, state.panBoundsRect.origin.y, 
+        state.panBoundsRect.size.width, state.panBoundsRect.size.height,
+        state.minScale, state.maxScale, state.rubberEffectRatio
+    };
+    unsigned char type = kPanZoomTraceRecordState;
+    unsigned char ignoreAnchorPointForPosition = state.ignoreAnchorPointForPosition ? 1 : 0;
+    int mode = state.mode;
+    unsigned int byteOrder = kPanZoomTraceByteOrder;
+    this->write(kPanZoomTraceMagic, 4);
+    this->write(&byteOrder, 4);
+    this->write(&type, 1);
+    this->write(values, sizeof(values));
+    this->write(&ignoreAnchorPointForPosition, 1);
+    this->write(&mode, 4);
+
+    const PanZoomFrameSettings& frame = controller.frameSettings;
+    float settings[kPanZoomTraceSettingsFloats] = {
+        controller.maxTouchDistanceToClick, controller.rubberEffectRecoveryTime,
+        controller.flingFriction, controller.flingMinVelocity, controller.predictionTime,
+        frame.topMargin, frame.bottomMargin, frame.leftMargin, frame.rightMargin,
+        frame.minSpeed, frame.maxSpeed
+    };
+    memcpy(settings + 11, frame.customSpeedCurve, sizeof(frame.customSpeedCurve));
+    unsigned char flags[kPanZoomTraceSettingsFlags] = {
+        (unsigned char)(controller.coalesceTouches ? 1 : 0), 
+        (unsigned char)(controller.rotationEnabled ? 1 : 0), 
+        (unsigned char)(controller.flingEnabled ? 1 : 0)
+    };
+    int speedCurve = frame.speedCurve;
+    this->write(settings, sizeof(settings));
+    this->write(flags, sizeof(flags));
+    this->write(&speedCurve, 4);
+    return true;
+}
+
+bool PanZoomTraceWriter::close()
+{
+    if (!_file)
+    {
+        return !_failed;
+    }
+    this->flush();
+    if (fclose(_file) != 0)
+    {
+        _failed = true;
+    }
+    _file = NULL;
+    return !_failed;
+}
+
+void PanZoomTraceWriter::writeEvent(const PanZoomTouchEvent& event)
+{
+    unsigned char type = (unsigned char)event.phase;
+    this->write(&type, 1);
+    if (event.phase == kPanZoomTouchFrame)
+    {
+        this->write(&event.dt, 4);
+    }
+    else
+    {
+        unsigned char lastInBatch = event.lastInBatch ? 1 : 0;
+        this->write(&lastInBatch, 1);
+        this->write(&event.touchId, 4);
+        this->write(&event.position.x, 4);
+        this->write(&event.position.y, 4);
+    }
+    this->write(&event.time, 8);
+}
+
+void PanZoomTraceWriter::writeTransform(const PanZoomState& state)
+{
+    unsigned char type = kPanZoomTraceRecordTransform;
+    this->write(&type, 1);
+    this->write(&state.position.x, 4);
+    this->write(&state.position.y, 4);
+    this->write(&state.scale, 4);
+}
+
+void PanZoomTraceWriter::flush()
+{
+    if (_file && _used)
+    {
+        this->writeBuffer();
+        if (!_failed && fflush(_file) != 0)
+        {
+            _failed = true;
+        }
+    }
+    _used = 0;
+}
+
+void PanZoomTraceWriter::writeBuffer()
+{
+    // After a short write the trace is cut, the records that follow would
+    // only make it unreadable.
+    if (!_failed && fwrite(_buffer, 1, _used, _file) != _used)
+    {
+        _failed = true;
+    }
+    _used = 0;
+}
+
+void PanZoomTraceWriter::write(const void* data, size_t size)
+{
+    if (!_file)
+    {
+        return;
+    }
+    if (_used + size > kPanZoomTraceBufferSize)
+    {
+        this->writeBuffer();
+    }
+    memcpy(_buffer + _used, data, size);
+    _used += size;
+}
+
+PanZoomTraceRecording::PanZoomTraceRecording()
+{
+}
+
+// Reads size bytes at offset, false past the end.
+static bool PanZoomTraceRead(const std::vector<unsigned char>& data, size_t& offset, void* value, size_t size)
+{
+    if (offset + size > data.size())
+    {
+        return false;
+    }
+    memcpy(value, &data[offset], size);
+    offset += size;
+    return true;
+}
+
+bool PanZoomTraceRecording::load(const char* path)
+{
+    events.clear();
+    transforms.clear();
+
+    FILE* file = fopen(path, "rb");
+    if (!file)
+    {
+        return false;
+    }
+    std::vector<unsigned char> data;
+    unsigned char chunk[kPanZoomTraceBufferSize];
+    size_t read;
+    while ((read = fread(chunk, 1, sizeof(chunk), file)) > 0)
+    {
+        data.insert(data.end(), chunk, chunk + read);
+    }
+    fclose(file);
+
+    size_t offset = 0;
+    char magic[4];
+    unsigned int byteOrder;
+    unsigned char type;
+    if (!PanZoomTraceRead(data, offset, magic, 4) || memcmp(magic, kPanZoomTraceMagic, 4) ||
+        !PanZoomTraceRead(data, offset, &byteOrder, 4) || byteOrder != kPanZoomTraceByteOrder ||
+        !PanZoomTraceRead(data, offset, &type, 1) || type != kPanZoomTraceRecordState)
+    {
+        return false;
+    }
+
+    float values[14];
+    unsigned char ignoreAnchorPointForPosition;
+    int mode;
+    if (!PanZoomTraceRead(data, offset, values, sizeof(values)) ||
+        !PanZoomTraceRead(data, offset, &ignoreAnchorPointForPosition, 1) ||
+        !PanZoomTraceRead(data, offset, &mode, 4))
+    {
+        return false;
+    }
+    state = PanZoomState();
+    state.position = PanZoomPointMake(values[0], values[1]);
+    state.scale = values[2];
+    state.anchorPoint = PanZoomPointMake(values[3], values[4]);
+    state.contentSize = PanZoomSizeMake(values[5], values[6]);
+    state.panBoundsRect = PanZoomRectMake(values[7], values[8], values[9], values[10]);
+    state.minScale = values[11];
+    state.maxScale = values[12];
+    state.rubberEffectRatio = values[13];
+    state.ignoreAnchorPointForPosition = ignoreAnchorPointForPosition != 0;
+    state.mode = (CCLayerPanZoomMode)mode;
+
+    float settingValues[kPanZoomTraceSettingsFloats];
+    unsigned char flags[kPanZoomTraceSettingsFlags];
+    int speedCurve;
+    if (!PanZoomTraceRead(data, offset, settingValues, sizeof(settingValues)) ||
+        !PanZoomTraceRead(data, offset, flags, sizeof(flags)) ||
+        !PanZoomTraceRead(data, offset, &speedCurve, 4))
+    {
+        return false;
+    }
+    settings = PanZoomTraceSettings();
+    settings.maxTouchDistanceToClick = settingValues[0];
+    settings.rubberEffectRecoveryTime = settingValues[1];
+    settings.flingFriction = settingValues[2];
+    settings.flingMinVelocity = settingValues[3];
+    settings.predictionTime = settingValues[4];
+    PanZoomFrameSettings& frame = settings.frameSettings;
+    frame.topMargin = settingValues[5];
+    frame.bottomMargin = settingValues[6];
+    frame.leftMargin = settingValues[7];
+    frame.rightMargin = settingValues[8];
+    frame.minSpeed = settingValues[9];
+    frame.maxSpeed = settingValues[10];
+    memcpy(frame.customSpeedCurve, settingValues + 11, sizeof(frame.customSpeedCurve));
+    frame.speedCurve = (CCLayerPanZoomEdgeSpeedCurve)speedCurve;
+    frame.precompute();
+    settings.coalesceTouches = flags[0] != 0;
+    settings.rotationEnabled = flags[1] != 0;
+    settings.flingEnabled = flags[2] != 0;
+
+    // A record cut short by a crash ends the trace.
+    while (PanZoomTraceRead(data, offset, &type, 1))
+    {
+        if (type == kPanZoomTraceRecordTransform)
+        {
+            PanZoomTraceTransform transform;
+            if (!PanZoomTraceRead(data, offset, &transform.position.x, 4) ||
+                !PanZoomTraceRead(data, offset, &transform.position.y, 4) ||
+                !PanZoomTraceRead(data, offset, &transform.scale, 4))
+            {
+                break;
+            }
+            transforms.push_back(transform);
+            continue;
+        }
+        if (type > kPanZoomTouchFrame)
+        {
+            return false;
+        }
+
+        PanZoomTouchEvent event;
+        event.phase = (PanZoomTouchPhase)type;
+        event.touchId = -1;
+        event.position = PanZoomPointMake(0.0f, 0.0f);
+        event.dt = 0.0f;
+        event.lastInBatch = true;
+        if (event.phase == kPanZoomTouchFrame)
+        {
+            if (!PanZoomTraceRead(data, offset, &event.dt, 4))
+            {
+                break;
+            }
+        }
+        else
+        {
+            unsigned char lastInBatch;
+            if (!PanZoomTraceRead(data, offset, &lastInBatch, 1) ||
+                !PanZoomTraceRead(data, offset, &event.touchId, 4) ||
+                !PanZoomTraceRead(data, offset, &event.position.x, 4) ||
+                !PanZoomTraceRead(data, offset, &event.position.y, 4))
+            {
+                break;
+            }
+            event.lastInBatch = lastInBatch != 0;
+        }
+        if (!PanZoomTraceRead(data, offset, &event.time, 8))
+        {
+            break;
+        }
+        events.push_back(event);
+    }
+    return true;
+}
+
+int PanZoomTraceRecording::replay(PanZoomController& controller) const
+{
+    controller.state.position = state.position;
+    controller.state.scale = state.scale;
+    controller.state.anchorPoint = state.anchorPoint;
+    controller.state.contentSize = state.contentSize;
+    controller.state.panBoundsRect = state.panBoundsRect;
+    controller.state.minScale = state.minScale;
+    controller.state.maxScale = state.maxScale;
+    controller.state.rubberEffectRatio = state.rubberEffectRatio;
+    controller.state.ignoreAnchorPointForPosition = state.ignoreAnchorPointForPosition;
+    controller.state.mode = state.mode;
+    settings.applyTo(controller);
+
+    PanZoomTracePlayer player(controller);
+    size_t transform = 0;
+    for (size_t i = 0; i < events.size(); ++i)
+    {
+        if (!player.play(events[i]))
+        {
+            continue;
+        }
+        if (transform >= transforms.size())
+        {
+            return (int)transform;
+        }
+        const PanZoomTraceTransform& expected = transforms[transform];
+        if (memcmp(&controller.state.position.x, &expected.position.x, 4) ||
+            memcmp(&controller.state.position.y, &expected.position.y, 4) ||
+            memcmp(&controller.state.scale, &expected.scale, 4))
+        {
+            return (int)transform;
+        }
+        ++transform;
+    }
+    return -1;
+}
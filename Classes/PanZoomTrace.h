@@ -0,0 +1,167 @@
+/*
+* CCLayerPanZoom
+*
+* Copyright (c) 2011 Alexey Lang
+* Copyright (c) 2011 Pavel Guganov
+*
+* http://www.cocos2d-x.org
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*
+*/
+
+
+#ifndef __PANZOOM_TRACE_H__
+#define __PANZOOM_TRACE_H__
+
+#include "PanZoomController.h"
+
+#include <stdio.h>
+#include <vector>
+
+typedef enum
+{
+    kPanZoomTouchBegan,
+    kPanZoomTouchMoved,
+    kPanZoomTouchEnded,
+    kPanZoomTouchCancelled,
+    /** Scheduler tick, dt is the frame time */
+    kPanZoomTouchFrame
+} PanZoomTouchPhase;
+
+struct PanZoomTouchEvent
+{
+    PanZoomTouchPhase phase;
+    int touchId;
+    // Touch position in GL space.
+    PanZoomPoint position;
+    // Frame time for kPanZoomTouchFrame.
+    float dt;
+    // Gesture clock time when the handler ran.
+    double time;
+    // Touches of one CCSet are delivered together, handler runs on the last one.
+    bool lastInBatch;
+};
+
+typedef std::vector<PanZoomTouchEvent> PanZoomTouchTrace;
+
+// Layer transform after a handler ran.
+struct PanZoomTraceTransform
+{
+    PanZoomPoint position;
+    float scale;
+};
+
+// Replays touch events through the same PanZoomController calls that
+// CCLayerPanZoom::ccTouches* and CCLayerPanZoom::update make, with the
+// controller clock following the event times.
+class PanZoomTracePlayer
+{
+public:
+    // Points controller at the player's clock until the player is destroyed.
+    PanZoomTracePlayer(PanZoomController& controller);
+    ~PanZoomTracePlayer();
+
+    // Returns true when the event ran a handler (last of its batch or a frame).
+    bool play(const PanZoomTouchEvent& event);
+
+private:
+    PanZoomController& _controller;
+    PanZoomClock* _previousClock;
+    PanZoomManualClock _clock;
+};
+
+// Controller settings a trace replays with, saved when recording starts.
+struct PanZoomTraceSettings
+{
+    // Settings of a default PanZoomController.
+    PanZoomTraceSettings();
+
+    PanZoomFrameSettings frameSettings;
+    float maxTouchDistanceToClick;
+    bool coalesceTouches;
+    bool rotationEnabled;
+    float rubberEffectRecoveryTime;
+    bool flingEnabled;
+    float flingFriction;
+    float flingMinVelocity;
+    float predictionTime;
+
+    void copyFrom(const PanZoomController& controller);
+    void applyTo(PanZoomController& controller) const;
+};
+
+#define kPanZoomTraceBufferSize 4096
+
+// Writes a binary trace: the layer state and controller settings, then every
+// touch event and frame followed by the transform its handler produced. Records are fixed size,
+// in host byte order (traces of the other byte order are rejected on load),
+// and collected in a fixed buffer, so recording doesn't allocate per event.
+class PanZoomTraceWriter
+{
+public:
+    PanZoomTraceWriter();
+    ~PanZoomTraceWriter();
+
+    // Starts a new trace file with the current state and settings of 
+    // controller.
+    bool open(const char* path, const PanZoomController& controller);
+    // Returns false when the trace couldn't be written completely.
+    bool close();
+    bool isOpen() const { return _file != NULL; }
+    // Whether writing to the open trace failed, later records are dropped.
+    bool failed() const { return _failed; }
+
+    void writeEvent(const PanZoomTouchEvent& event);
+    void writeTransform(const PanZoomState& state);
+    void flush();
+
+private:
+    void write(const void* data, size_t size);
+    void writeBuffer();
+
+    FILE* _file;
+    bool _failed;
+    unsigned char _buffer[kPanZoomTraceBufferSize];
+    size_t _used;
+};
+
+// Trace read back from a file written by PanZoomTraceWriter.
+class PanZoomTraceRecording
+{
+public:
+    PanZoomTraceRecording();
+
+    bool load(const char* path);
+
+    // State and settings of the layer when recording started.
+    PanZoomState state;
+    PanZoomTraceSettings settings;
+    PanZoomTouchTrace events;
+    // One transform per handler run.
+    std::vector<PanZoomTraceTransform> transforms;
+
+    // Restores the recorded state and settings into controller, replays the
+    // events and compares every transform bit for bit. The controller clock
+    // is left as it was. Returns the index of the first differing transform,
+    // or -1 if all match.
+    int replay(PanZoomController& controller) const;
+};
+
+#endif // __PANZOOM_TRACE_H__
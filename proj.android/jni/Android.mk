@@ -9,7 +9,17 @@ LOCAL_MODULE_FILENAME := libgame
 LOCAL_SRC_FILES := hellocpp/main.cpp \
                    ../../Classes/AppDelegate.cpp \
                    ../../Classes/CCLayerPanZoom.cpp \
-                   ../../Classes/HelloWorldScene.cpp
+                   ../../Classes/CCLayerPanZoomAsyncTileProvider.cpp \
+                   ../../Classes/HelloWorldScene.cpp \
+                   ../../Classes/PanZoomClock.cpp \
+                   ../../Classes/PanZoomController.cpp \
+                   ../../Classes/PanZoomSpatialIndex.cpp \
+                   ../../Classes/PanZoomState.cpp \
+                   ../../Classes/PanZoomStats.cpp \
+                   ../../Classes/PanZoomTileCache.cpp \
+                   ../../Classes/PanZoomTileLoader.cpp \
+                   ../../Classes/PanZoomTiling.cpp \
+                   ../../Classes/PanZoomTrace.cpp
                    
 LOCAL_C_INCLUDES := $(LOCAL_PATH)/../../Classes                   
 
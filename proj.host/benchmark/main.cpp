@@ -0,0 +1,231 @@
+/*
+* CCLayerPanZoom
+*
+* Copyright (c) 2011 Alexey Lang
+* Copyright (c) 2011 Pavel Guganov
+*
+* http://www.cocos2d-x.org
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*
+*/
+
+// Host benchmark: replays the synthetic traces (and recorded traces given on
+// the command line) and prints ns/event, allocations/event and p50/p99 
+// latency. Built against cocos2d-x it also replays them through the 
+// CCLayerPanZoom touch handlers and update().
+//
+//   panzoom_benchmark [iterations] [trace ...]
+
+#include "PanZoomBenchmark.h"
+
+#ifdef PANZOOM_BENCHMARK_LAYER
+#include "CCLayerPanZoom.h"
+#include <map>
+#include <vector>
+
+using namespace cocos2d;
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <new>
+
+static unsigned long s_allocations = 0;
+
+void* operator new(size_t size) throw(std::bad_alloc)
+{
+    ++s_allocations;
+    void* p = malloc(size ? size : 1);
+    if (!p)
+    {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void* p) throw()
+{
+    free(p);
+}
+
+static unsigned long allocationCount()
+{
+    return s_allocations;
+}
+
+#ifdef PANZOOM_BENCHMARK_LAYER
+
+// Lets a replay start from the benchmark prototype's settings.
+class CCLayerPanZoomBenchmarkLayer : public CCLayerPanZoom
+{
+public:
+    CREATE_FUNC(CCLayerPanZoomBenchmarkLayer);
+
+    void setController(const PanZoomController& controller)
+    {
+        _controller = controller;
+    }
+};
+
+// Delivers the replayed batches as CCSets to the CCLayerPanZoom handlers, and
+// frames to update() as if it was scheduled every frame.
+class CCLayerPanZoomReplayTarget : public PanZoomReplayTarget
+{
+public:
+    CCLayerPanZoomReplayTarget()
+    : _layer(CCLayerPanZoomBenchmarkLayer::create()),
+      _phase(kPanZoomTouchFrame),
+      _dt(0.0f)
+    {
+        _layer->retain();
+    }
+
+    virtual ~CCLayerPanZoomReplayTarget()
+    {
+        this->clearTouches();
+        for (std::map<int, CCTouch*>::iterator it = _touchById.begin(); it != _touchById.end(); ++it)
+        {
+            it->second->release();
+        }
+        _layer->release();
+    }
+
+    virtual void reset(const PanZoomController& prototype)
+    {
+        _layer->setController(prototype);
+        _layer->setClock(&_clock);
+        // Mirror the prototype state on the node without the layer's clamping.
+        const PanZoomState& state = prototype.state;
+        _layer->CCLayer::setContentSize(CCSizeMake(state.contentSize.width, state.contentSize.height));
+        _layer->CCLayer::setAnchorPoint(ccp(state.anchorPoint.x, state.anchorPoint.y));
+        _layer->CCLayer::ignoreAnchorPointForPosition(state.ignoreAnchorPointForPosition);
+        _layer->CCLayer::setScale(state.scale);
+        _layer->CCLayer::setPosition(ccp(state.position.x, state.position.y));
+        this->clearTouches();
+    }
+
+    virtual void stage(const PanZoomTouchEvent& event)
+    {
+        _clock.setTime(event.time);
+        _phase = event.phase;
+        _dt = event.dt;
+        if (event.phase == kPanZoomTouchFrame)
+        {
+            return;
+        }
+
+        CCTouch*& touch = _touchById[event.touchId];
+        if (!touch)
+        {
+            touch = new CCTouch();
+        }
+        CCPoint location = CCDirector::sharedDirector()->convertToUI(ccp(event.position.x, event.position.y));
+        touch->setTouchInfo(event.touchId, location.x, location.y);
+        _touches.addObject(touch);
+        _staged.push_back(touch);
+    }
+
+    virtual void deliver()
+    {
+        switch (_phase)
+        {
+        case kPanZoomTouchBegan:
+            _layer->ccTouchesBegan(&_touches, NULL);
+            break;
+        case kPanZoomTouchMoved:
+            _layer->ccTouchesMoved(&_touches, NULL);
+            break;
+        case kPanZoomTouchEnded:
+            _layer->ccTouchesEnded(&_touches, NULL);
+            break;
+        case kPanZoomTouchCancelled:
+            _layer->ccTouchesCancelled(&_touches, NULL);
+            break;
+        case kPanZoomTouchFrame:
+            _layer->update(_dt);
+            break;
+        }
+        this->clearTouches();
+    }
+
+private:
+    void clearTouches()
+    {
+        for (size_t i = 0; i < _staged.size(); ++i)
+        {
+            _touches.removeObject(_staged[i]);
+        }
+        _staged.clear();
+    }
+
+    CCLayerPanZoomBenchmarkLayer* _layer;
+    PanZoomManualClock _clock;
+    std::map<int, CCTouch*> _touchById;
+    CCSet _touches;
+    std::vector<CCTouch*> _staged;
+    PanZoomTouchPhase _phase;
+    float _dt;
+};
+
+#endif // PANZOOM_BENCHMARK_LAYER
+
+int main(int argc, char** argv)
+{
+    unsigned int iterations = argc > 1 ? (unsigned int)atoi(argv[1]) : 50;
+    if (!iterations)
+    {
+        fprintf(stderr, "usage: %s [iterations] [trace ...]\n", argv[0]);
+        return 1;
+    }
+
+    PanZoomBenchmark benchmark;
+    benchmark.setAllocationCounter(allocationCount);
+
+    PanZoomControllerReplayTarget controllerTarget;
+    printf("PanZoomController\n");
+    benchmark.runDefaultSuite(stdout, iterations, controllerTarget);
+    printf("\nPanZoomState\n");
+    benchmark.runConversions(stdout, 10000, iterations);
+#ifdef PANZOOM_BENCHMARK_LAYER
+    CCLayerPanZoomReplayTarget layerTarget;
+    printf("\nCCLayerPanZoom\n");
+    benchmark.runDefaultSuite(stdout, iterations, layerTarget);
+#endif
+
+    for (int i = 2; i < argc; ++i)
+    {
+        PanZoomTraceRecording recording;
+        if (!recording.load(argv[i]))
+        {
+            fprintf(stderr, "%s: can't load trace\n", argv[i]);
+            return 1;
+        }
+        PanZoomController prototype = benchmark.prototype;
+        benchmark.prototype.state = recording.state;
+        recording.settings.applyTo(benchmark.prototype);
+        printf("\n%s\n", argv[i]);
+        PanZoomBenchmark::printResult(stdout, benchmark.run("controller", recording.events, iterations, controllerTarget));
+#ifdef PANZOOM_BENCHMARK_LAYER
+        PanZoomBenchmark::printResult(stdout, benchmark.run("layer", recording.events, iterations, layerTarget));
+#endif
+        benchmark.prototype = prototype;
+    }
+    return 0;
+}
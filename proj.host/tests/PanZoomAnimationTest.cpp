@@ -0,0 +1,153 @@
+/*
+* CCLayerPanZoom
+*
+* Copyright (c) 2011 Alexey Lang
+* Copyright (c) 2011 Pavel Guganov
+*
+* http://www.cocos2d-x.org
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*
+*/
+
+#include "PanZoomTest.h"
+#include "PanZoomController.h"
+
+#define kPanZoomTestFrame (1.0f / 60.0f)
+
+static PanZoomController controllerInBounds()
+{
+    PanZoomController controller;
+    controller.state.contentSize = PanZoomSizeMake(2000.0f, 2000.0f);
+    controller.state.ignoreAnchorPointForPosition = false;
+    controller.state.panBoundsRect = PanZoomRectMake(0.0f, 0.0f, 480.0f, 320.0f);
+    controller.state.position = PanZoomPointMake(240.0f, 160.0f);
+    return controller;
+}
+
+static bool near(float a, float b, float tolerance)
+{
+    return fabsf(a - b) <= tolerance;
+}
+
+// Runs frames until the animation ends, returns the number of frames.
+static unsigned int finish(PanZoomController& controller, unsigned int& endedEvents)
+{
+    unsigned int frames = 0;
+    endedEvents = 0;
+    while (controller.animating && frames < 1000)
+    {
+        if (controller.update(kPanZoomTestFrame) & kPanZoomUpdateAnimationEnded)
+        {
+            ++endedEvents;
+        }
+        ++frames;
+    }
+    return frames;
+}
+
+static void testZoomToRect()
+{
+    PanZoomController controller = controllerInBounds();
+    PanZoomRect viewport = controller.state.panBoundsRect;
+    PanZoomPoint viewportCenter = PanZoomPointMake(240.0f, 160.0f);
+    PanZoomPoint startPosition = controller.state.position;
+
+    // 240 x 80 fits the 480 x 320 viewport at scale 2.
+    PanZoomRect rect = PanZoomRectMake(900.0f, 1000.0f, 240.0f, 80.0f);
+    controller.animateToRect(rect, viewport, 0.5f, kCCLayerPanZoomEasingLinear);
+    PANZOOM_CHECK(controller.animating);
+    PANZOOM_CHECK(controller.state.position.x == startPosition.x);
+    PANZOOM_CHECK(controller.state.position.y == startPosition.y);
+    PANZOOM_CHECK(controller.state.scale == 1.0f);
+
+    // Halfway a linear zoom is at the geometric mean of the scales.
+    for (unsigned int frame = 0; frame < 15; ++frame)
+    {
+        controller.update(kPanZoomTestFrame);
+    }
+    PANZOOM_CHECK(controller.animating);
+    PANZOOM_CHECK(near(controller.state.scale, sqrtf(2.0f), 1.0e-4f));
+
+    unsigned int endedEvents;
+    unsigned int frames = finish(controller, endedEvents);
+    PANZOOM_CHECK(frames == 15);
+    PANZOOM_CHECK(endedEvents == 1);
+    PANZOOM_CHECK(!controller.animating);
+    PANZOOM_CHECK(!controller.needsUpdate());
+    PANZOOM_CHECK(controller.state.scale == 2.0f);
+    PanZoomPoint center = controller.state.convertToNodeSpace(viewportCenter);
+    PANZOOM_CHECK(near(center.x, 1020.0f, 0.01f));
+    PANZOOM_CHECK(near(center.y, 1040.0f, 0.01f));
+}
+
+static void testZoomToRectLimits()
+{
+    // A tiny rect is limited by maxScale, still centered.
+    PanZoomController controller = controllerInBounds();
+    PanZoomRect viewport = controller.state.panBoundsRect;
+    PanZoomPoint viewportCenter = PanZoomPointMake(240.0f, 160.0f);
+    controller.animateToRect(PanZoomRectMake(995.0f, 995.0f, 10.0f, 10.0f), viewport, 0.0f, 
+        kCCLayerPanZoomEasingEaseInOut);
+    PANZOOM_CHECK(!controller.animating);
+    PANZOOM_CHECK(controller.state.scale == controller.state.maxScale);
+    PanZoomPoint center = controller.state.convertToNodeSpace(viewportCenter);
+    PANZOOM_CHECK(near(center.x, 1000.0f, 0.01f));
+    PANZOOM_CHECK(near(center.y, 1000.0f, 0.01f));
+
+    // A rect in the corner ends with the layer covering the bounds.
+    controller = controllerInBounds();
+    controller.animateToRect(PanZoomRectMake(0.0f, 0.0f, 480.0f, 320.0f), viewport, 0.3f, 
+        kCCLayerPanZoomEasingEaseOut);
+    unsigned int endedEvents;
+    finish(controller, endedEvents);
+    PANZOOM_CHECK(endedEvents == 1);
+    PANZOOM_CHECK(controller.state.scale == 1.0f);
+    PanZoomEdgeDistances edges = controller.state.edgeDistances();
+    PANZOOM_CHECK(!edges.left && !edges.right && !edges.top && !edges.bottom);
+    PanZoomPoint corner = controller.state.convertToNodeSpace(PanZoomPointMake(0.0f, 0.0f));
+    PANZOOM_CHECK(near(corner.x, 0.0f, 0.01f));
+    PANZOOM_CHECK(near(corner.y, 0.0f, 0.01f));
+}
+
+static void testTouchStopsAnimation()
+{
+    PanZoomController controller = controllerInBounds();
+    controller.animateToRect(PanZoomRectMake(900.0f, 1000.0f, 240.0f, 80.0f), 
+        controller.state.panBoundsRect, 1.0f, kCCLayerPanZoomEasingLinear);
+    controller.update(kPanZoomTestFrame);
+    PanZoomPoint position = controller.state.position;
+    float scale = controller.state.scale;
+
+    controller.addTouch(0, PanZoomPointMake(240.0f, 160.0f));
+    controller.touchesBegan();
+    PANZOOM_CHECK(!controller.animating);
+    PANZOOM_CHECK(!(controller.update(kPanZoomTestFrame) & kPanZoomUpdateAnimationEnded));
+    PANZOOM_CHECK(controller.state.position.x == position.x);
+    PANZOOM_CHECK(controller.state.position.y == position.y);
+    PANZOOM_CHECK(controller.state.scale == scale);
+}
+
+int main()
+{
+    testZoomToRect();
+    testZoomToRectLimits();
+    testTouchStopsAnimation();
+    return PanZoomTestResult();
+}
@@ -0,0 +1,156 @@
+/*
+* CCLayerPanZoom
+*
+* Copyright (c) 2011 Alexey Lang
+* Copyright (c) 2011 Pavel Guganov
+*
+* http://www.cocos2d-x.org
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*
+*/
+
+#include "PanZoomTest.h"
+#include "PanZoomState.h"
+
+#include <string.h>
+#include <vector>
+
+#define kPanZoomConversionMaxPoints 37
+
+static PanZoomState makeState()
+{
+    PanZoomState state;
+    state.contentSize = PanZoomSizeMake(2048.0f, 1536.0f);
+    state.position = PanZoomPointMake(-313.25f, -127.5f);
+    state.scale = 1.37f;
+    state.anchorPoint = PanZoomPointMake(0.5f, 0.5f);
+    return state;
+}
+
+// Points that don't round trip exactly, interleaved x, y.
+static void fillPoints(float* xy, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+    {
+        xy[i * 2] = (float)i * 37.113f - 211.7f;
+        xy[i * 2 + 1] = 1000.0f / ((float)i + 3.0f) + (float)i * 0.3f;
+    }
+}
+
+static bool sameBits(float a, float b)
+{
+    return memcmp(&a, &b, sizeof(float)) == 0;
+}
+
+// Batch conversion of n points at offset floats into the buffers, checked
+// bit for bit against single point conversions and against the batch 
+// conversion one point at a time (which only takes the scalar path).
+static void checkConversion(const PanZoomState& state, bool toNode, size_t n, size_t offset, bool inPlace)
+{
+    std::vector<float> input(kPanZoomConversionMaxPoints * 2 + 8);
+    std::vector<float> output(kPanZoomConversionMaxPoints * 2 + 8, -1.0f);
+    float* xy = &input[offset];
+    float* out = inPlace ? xy : &output[offset];
+    fillPoints(xy, n);
+    std::vector<float> source(xy, xy + n * 2);
+
+    if (toNode)
+    {
+        state.convertToNodeSpace(xy, out, n);
+    }
+    else
+    {
+        state.convertToParentSpace(xy, out, n);
+    }
+
+    bool matches = true;
+    for (size_t i = 0; i < n; ++i)
+    {
+        PanZoomPoint point = PanZoomPointMake(source[i * 2], source[i * 2 + 1]);
+        PanZoomPoint single = toNode ? state.convertToNodeSpace(point) : state.convertToParentSpace(point);
+        float scalar[2];
+        if (toNode)
+        {
+            state.convertToNodeSpace(&source[i * 2], scalar, 1);
+        }
+        else
+        {
+            state.convertToParentSpace(&source[i * 2], scalar, 1);
+        }
+        matches = matches && sameBits(out[i * 2], single.x) && sameBits(out[i * 2 + 1], single.y) && 
+            sameBits(out[i * 2], scalar[0]) && sameBits(out[i * 2 + 1], scalar[1]);
+    }
+    PANZOOM_CHECK(matches);
+    if (!inPlace)
+    {
+        // Nothing written past the points.
+        PANZOOM_CHECK(output[offset + n * 2] == -1.0f);
+        PANZOOM_CHECK(offset == 0 || output[offset - 1] == -1.0f);
+    }
+}
+
+static void testBatchConversions()
+{
+    PanZoomState state = makeState();
+    for (int toNode = 0; toNode < 2; ++toNode)
+    {
+        // Empty, shorter than a SIMD step, odd counts with a scalar tail.
+        for (size_t n = 0; n <= kPanZoomConversionMaxPoints; ++n)
+        {
+            // Unaligned starts.
+            for (size_t offset = 0; offset < 4; ++offset)
+            {
+                checkConversion(state, toNode != 0, n, offset, false);
+            }
+            checkConversion(state, toNode != 0, n, 1, true);
+        }
+    }
+
+    // The cached transform follows the state.
+    state.scale = 0.61f;
+    state.ignoreAnchorPointForPosition = false;
+    checkConversion(state, true, 9, 1, false);
+    checkConversion(state, false, 9, 1, false);
+}
+
+static void testRoundTrip()
+{
+    PanZoomState state = makeState();
+    state.scale = 2.0f;
+    float xy[10];
+    float node[10];
+    float parent[10];
+    fillPoints(xy, 5);
+    state.convertToNodeSpace(xy, node, 5);
+    state.convertToParentSpace(node, parent, 5);
+    bool close = true;
+    for (size_t i = 0; i < 10; ++i)
+    {
+        close = close && fabsf(parent[i] - xy[i]) < 1.0e-3f;
+    }
+    PANZOOM_CHECK(close);
+}
+
+int main()
+{
+    testBatchConversions();
+    testRoundTrip();
+    return PanZoomTestResult();
+}
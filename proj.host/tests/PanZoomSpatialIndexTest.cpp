@@ -0,0 +1,217 @@
+/*
+* CCLayerPanZoom
+*
+* Copyright (c) 2011 Alexey Lang
+* Copyright (c) 2011 Pavel Guganov
+*
+* http://www.cocos2d-x.org
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*
+*/
+
+#include "PanZoomTest.h"
+#include "PanZoomSpatialIndex.h"
+
+#include <algorithm>
+
+class PanZoomSpatialIndexTest
+{
+public:
+    static void setQueryStamp(PanZoomSpatialIndex& index, unsigned int queryStamp)
+    {
+        index._queryStamp = queryStamp;
+    }
+};
+
+static void* item(long n)
+{
+    return (void*)n;
+}
+
+static bool found(const std::vector<void*>& result, void* item)
+{
+    return std::count(result.begin(), result.end(), item) == 1;
+}
+
+// 4x4 grid of 100 point cells over (0, 0) - (400, 400).
+static void makeGrid(PanZoomSpatialIndex& index)
+{
+    index.setGrid(PanZoomRectMake(0.0f, 0.0f, 400.0f, 400.0f), 100.0f);
+}
+
+static void testInsertMoveRemove()
+{
+    PanZoomSpatialIndex index;
+    makeGrid(index);
+    PANZOOM_CHECK(index.count() == 0);
+
+    index.insert(item(1), PanZoomRectMake(10.0f, 10.0f, 20.0f, 20.0f), 0, 0);
+    index.insert(item(2), PanZoomRectMake(210.0f, 210.0f, 20.0f, 20.0f), 0, 1);
+    PANZOOM_CHECK(index.count() == 2);
+    PANZOOM_CHECK(index.contains(item(1)) && index.contains(item(2)));
+    // Nothing queried yet.
+    PANZOOM_CHECK(!index.isInLastQuery(item(1)));
+
+    std::vector<void*> result;
+    index.query(PanZoomRectMake(0.0f, 0.0f, 50.0f, 50.0f), result);
+    PANZOOM_CHECK(result.size() == 1 && found(result, item(1)));
+    PANZOOM_CHECK(index.isInLastQuery(item(1)) && !index.isInLastQuery(item(2)));
+
+    // Moved into another cell, the old one no longer finds it.
+    index.update(item(1), PanZoomRectMake(310.0f, 310.0f, 20.0f, 20.0f));
+    result.clear();
+    index.query(PanZoomRectMake(0.0f, 0.0f, 50.0f, 50.0f), result);
+    PANZOOM_CHECK(result.empty());
+    result.clear();
+    index.query(PanZoomRectMake(300.0f, 300.0f, 50.0f, 50.0f), result);
+    PANZOOM_CHECK(result.size() == 1 && found(result, item(1)));
+
+    // Inserting a known item moves it.
+    index.insert(item(2), PanZoomRectMake(320.0f, 320.0f, 20.0f, 20.0f), 0, 1);
+    PANZOOM_CHECK(index.count() == 2);
+    result.clear();
+    index.query(PanZoomRectMake(300.0f, 300.0f, 50.0f, 50.0f), result);
+    PANZOOM_CHECK(result.size() == 2 && found(result, item(1)) && found(result, item(2)));
+    PANZOOM_CHECK(index.topmostAt(PanZoomPointMake(325.0f, 325.0f)) == item(2));
+    index.setOrder(item(1), 1, 0);
+    PANZOOM_CHECK(index.topmostAt(PanZoomPointMake(325.0f, 325.0f)) == item(1));
+
+    index.remove(item(1));
+    PANZOOM_CHECK(index.count() == 1 && !index.contains(item(1)));
+    PANZOOM_CHECK(!index.isInLastQuery(item(1)));
+    result.clear();
+    index.query(PanZoomRectMake(300.0f, 300.0f, 50.0f, 50.0f), result);
+    PANZOOM_CHECK(result.size() == 1 && found(result, item(2)));
+    result.clear();
+    index.queryPoint(PanZoomPointMake(315.0f, 315.0f), result);
+    PANZOOM_CHECK(result.empty());
+
+    // The freed entry is reused.
+    index.insert(item(3), PanZoomRectMake(10.0f, 10.0f, 20.0f, 20.0f), 0, 2);
+    PANZOOM_CHECK(index.count() == 2);
+    PANZOOM_CHECK(index.topmostAt(PanZoomPointMake(15.0f, 15.0f)) == item(3));
+
+    index.clear();
+    PANZOOM_CHECK(index.count() == 0 && !index.contains(item(2)));
+}
+
+// An item spanning a cell boundary is returned once, from either side.
+static void testCellBoundary()
+{
+    PanZoomSpatialIndex index;
+    makeGrid(index);
+    index.insert(item(1), PanZoomRectMake(90.0f, 90.0f, 20.0f, 20.0f), 0, 0);
+
+    std::vector<void*> result;
+    index.query(PanZoomRectMake(0.0f, 0.0f, 400.0f, 400.0f), result);
+    PANZOOM_CHECK(result.size() == 1 && found(result, item(1)));
+
+    result.clear();
+    index.query(PanZoomRectMake(105.0f, 105.0f, 10.0f, 10.0f), result);
+    PANZOOM_CHECK(result.size() == 1 && found(result, item(1)));
+
+    result.clear();
+    index.query(PanZoomRectMake(80.0f, 95.0f, 40.0f, 10.0f), result);
+    PANZOOM_CHECK(result.size() == 1 && found(result, item(1)));
+
+    // In the same cells, but not overlapping.
+    result.clear();
+    index.query(PanZoomRectMake(150.0f, 150.0f, 10.0f, 10.0f), result);
+    PANZOOM_CHECK(result.empty());
+
+    PANZOOM_CHECK(index.topmostAt(PanZoomPointMake(95.0f, 95.0f)) == item(1));
+    PANZOOM_CHECK(index.topmostAt(PanZoomPointMake(105.0f, 105.0f)) == item(1));
+    PANZOOM_CHECK(index.topmostAt(PanZoomPointMake(115.0f, 105.0f)) == NULL);
+}
+
+// Rects outside the grid are kept in the border cells.
+static void testOutsideGrid()
+{
+    PanZoomSpatialIndex index;
+    makeGrid(index);
+    index.insert(item(1), PanZoomRectMake(-200.0f, 150.0f, 20.0f, 20.0f), 0, 0);
+    index.insert(item(2), PanZoomRectMake(500.0f, 500.0f, 20.0f, 20.0f), 0, 1);
+    index.insert(item(3), PanZoomRectMake(-1000.0f, -1000.0f, 3000.0f, 3000.0f), -1, 2);
+
+    std::vector<void*> result;
+    index.query(PanZoomRectMake(-300.0f, 100.0f, 200.0f, 100.0f), result);
+    PANZOOM_CHECK(result.size() == 2 && found(result, item(1)) && found(result, item(3)));
+
+    result.clear();
+    index.query(PanZoomRectMake(450.0f, 450.0f, 100.0f, 100.0f), result);
+    PANZOOM_CHECK(result.size() == 2 && found(result, item(2)) && found(result, item(3)));
+
+    // Border cells hold them, but the rects still have to intersect.
+    result.clear();
+    index.query(PanZoomRectMake(0.0f, 150.0f, 20.0f, 20.0f), result);
+    PANZOOM_CHECK(result.size() == 1 && found(result, item(3)));
+
+    PANZOOM_CHECK(index.topmostAt(PanZoomPointMake(-190.0f, 160.0f)) == item(1));
+    PANZOOM_CHECK(index.topmostAt(PanZoomPointMake(510.0f, 510.0f)) == item(2));
+    PANZOOM_CHECK(index.topmostAt(PanZoomPointMake(-500.0f, 1500.0f)) == item(3));
+    result.clear();
+    index.queryPoint(PanZoomPointMake(510.0f, 510.0f), result);
+    PANZOOM_CHECK(result.size() == 2 && result[0] == item(2) && result[1] == item(3));
+
+    // Shrinking the grid rebuckets them.
+    index.setGrid(PanZoomRectMake(0.0f, 0.0f, 100.0f, 100.0f), 50.0f);
+    result.clear();
+    index.query(PanZoomRectMake(450.0f, 450.0f, 100.0f, 100.0f), result);
+    PANZOOM_CHECK(result.size() == 2 && found(result, item(2)) && found(result, item(3)));
+}
+
+static void testQueryStampWraparound()
+{
+    PanZoomSpatialIndex index;
+    makeGrid(index);
+    index.insert(item(1), PanZoomRectMake(10.0f, 10.0f, 20.0f, 20.0f), 0, 0);
+    index.insert(item(2), PanZoomRectMake(310.0f, 310.0f, 20.0f, 20.0f), 0, 1);
+
+    // Stamps item 1 with 1.
+    std::vector<void*> result;
+    index.query(PanZoomRectMake(0.0f, 0.0f, 50.0f, 50.0f), result);
+    PANZOOM_CHECK(result.size() == 1 && index.isInLastQuery(item(1)));
+
+    PanZoomSpatialIndexTest::setQueryStamp(index, 0xfffffffeu);
+    result.clear();
+    index.query(PanZoomRectMake(300.0f, 300.0f, 50.0f, 50.0f), result);
+    PANZOOM_CHECK(result.size() == 1 && found(result, item(2)));
+    PANZOOM_CHECK(!index.isInLastQuery(item(1)) && index.isInLastQuery(item(2)));
+
+    // The stamp wraps back to 1, item 1's old stamp mustn't hide it.
+    result.clear();
+    index.query(PanZoomRectMake(0.0f, 0.0f, 400.0f, 400.0f), result);
+    PANZOOM_CHECK(result.size() == 2 && found(result, item(1)) && found(result, item(2)));
+    PANZOOM_CHECK(index.isInLastQuery(item(1)) && index.isInLastQuery(item(2)));
+
+    result.clear();
+    index.query(PanZoomRectMake(0.0f, 0.0f, 50.0f, 50.0f), result);
+    PANZOOM_CHECK(result.size() == 1 && found(result, item(1)));
+    PANZOOM_CHECK(index.isInLastQuery(item(1)) && !index.isInLastQuery(item(2)));
+}
+
+int main()
+{
+    testInsertMoveRemove();
+    testCellBoundary();
+    testOutsideGrid();
+    testQueryStampWraparound();
+    return PanZoomTestResult();
+}
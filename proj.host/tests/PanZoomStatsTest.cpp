@@ -0,0 +1,133 @@
+/*
+* CCLayerPanZoom
+*
+* Copyright (c) 2011 Alexey Lang
+* Copyright (c) 2011 Pavel Guganov
+*
+* http://www.cocos2d-x.org
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*
+*/
+
+#include "PanZoomTest.h"
+#include "PanZoomController.h"
+#include "PanZoomStats.h"
+
+#include <string.h>
+
+static void testFrames()
+{
+    PanZoomStats stats;
+    PANZOOM_CHECK(stats.frameCount() == 0);
+    PANZOOM_CHECK(stats.historyCount() == 0);
+
+    stats.count(kPanZoomStatTouchEvents, 3);
+    stats.count(kPanZoomStatClamps, 1);
+    stats.addTime(kPanZoomTimerUpdate, 0.5);
+    PANZOOM_CHECK(stats.currentFrame().counts[kPanZoomStatTouchEvents] == 3);
+    stats.endFrame();
+    PANZOOM_CHECK(stats.frameCount() == 1);
+    PANZOOM_CHECK(stats.lastFrame().counts[kPanZoomStatTouchEvents] == 3);
+    PANZOOM_CHECK(stats.lastFrame().counts[kPanZoomStatClamps] == 1);
+    PANZOOM_CHECK(stats.lastFrame().times[kPanZoomTimerUpdate] == 0.5);
+    PANZOOM_CHECK(stats.currentFrame().counts[kPanZoomStatTouchEvents] == 0);
+    PANZOOM_CHECK(stats.currentFrame().times[kPanZoomTimerUpdate] == 0.0);
+
+    // The history keeps the newest kPanZoomStatsHistory frames, totals all.
+    unsigned int frames = kPanZoomStatsHistory + 80;
+    for (unsigned int frame = 1; frame <= frames; ++frame)
+    {
+        stats.count(kPanZoomStatTouchEvents, frame);
+        stats.endFrame();
+    }
+    PANZOOM_CHECK(stats.frameCount() == frames + 1);
+    PANZOOM_CHECK(stats.historyCount() == kPanZoomStatsHistory);
+    PANZOOM_CHECK(stats.historyFrame(0).counts[kPanZoomStatTouchEvents] == frames + 1 - kPanZoomStatsHistory);
+    PANZOOM_CHECK(stats.historyFrame(kPanZoomStatsHistory - 1).counts[kPanZoomStatTouchEvents] == frames);
+    PANZOOM_CHECK(stats.totals().counts[kPanZoomStatTouchEvents] == 3 + frames * (frames + 1) / 2);
+    PANZOOM_CHECK(stats.totals().counts[kPanZoomStatClamps] == 1);
+
+    // A header and one row per kept frame.
+    FILE* file = tmpfile();
+    PANZOOM_CHECK(file != NULL);
+    if (file)
+    {
+        stats.writeCSV(file);
+        rewind(file);
+        char line[512];
+        unsigned int lines = 0;
+        while (fgets(line, sizeof(line), file))
+        {
+            if (lines == 0)
+            {
+                PANZOOM_CHECK(strncmp(line, "frame,", 6) == 0);
+            }
+            ++lines;
+        }
+        PANZOOM_CHECK(lines == kPanZoomStatsHistory + 1);
+        fclose(file);
+    }
+
+    stats.reset();
+    PANZOOM_CHECK(stats.frameCount() == 0);
+    PANZOOM_CHECK(stats.historyCount() == 0);
+    PANZOOM_CHECK(stats.totals().counts[kPanZoomStatTouchEvents] == 0);
+}
+
+static void testControllerCounters()
+{
+    PanZoomController controller;
+    controller.state.contentSize = PanZoomSizeMake(1000.0f, 1000.0f);
+    controller.state.anchorPoint = PanZoomPointMake(0.0f, 0.0f);
+    controller.state.ignoreAnchorPointForPosition = false;
+    controller.state.panBoundsRect = PanZoomRectMake(0.0f, 0.0f, 480.0f, 320.0f);
+    controller.state.rubberEffectRatio = 0.5f;
+
+    controller.setPosition(PanZoomPointMake(-100.0f, -100.0f));
+    PANZOOM_CHECK(controller.stats.currentFrame().counts[kPanZoomStatClamps] == 1);
+    PANZOOM_CHECK(controller.stats.currentFrame().counts[kPanZoomStatRecoveriesStarted] == 0);
+
+    // Dragged past the left bounds with the rubber effect, the release
+    // starts one recovery.
+    controller.state.position = PanZoomPointMake(100.0f, -100.0f);
+    controller.touchesEnded();
+    PANZOOM_CHECK(controller.rubberEffectRecovering);
+    PANZOOM_CHECK(controller.stats.currentFrame().counts[kPanZoomStatRecoveriesStarted] == 1);
+    controller.stats.endFrame();
+
+    unsigned int frames = 0;
+    while (controller.rubberEffectRecovering && frames < 600)
+    {
+        controller.update(1.0f / 60.0f);
+        controller.stats.endFrame();
+        ++frames;
+    }
+    PANZOOM_CHECK(!controller.rubberEffectRecovering);
+    PANZOOM_CHECK(controller.state.position.x == 0.0f);
+    PANZOOM_CHECK(controller.stats.totals().counts[kPanZoomStatRecoveriesStarted] == 1);
+    PANZOOM_CHECK(controller.stats.frameCount() == frames + 1);
+}
+
+int main()
+{
+    testFrames();
+    testControllerCounters();
+    return PanZoomTestResult();
+}
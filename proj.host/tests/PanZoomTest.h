@@ -0,0 +1,60 @@
+/*
+* CCLayerPanZoom
+*
+* Copyright (c) 2011 Alexey Lang
+* Copyright (c) 2011 Pavel Guganov
+*
+* http://www.cocos2d-x.org
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*
+*/
+
+#ifndef __PANZOOM_TEST_H__
+#define __PANZOOM_TEST_H__
+
+#include <stdio.h>
+
+// Minimal checks for the host tests: failures are printed and counted, main
+// returns PanZoomTestResult() so ctest sees them.
+
+static unsigned int s_panZoomTestFailures = 0;
+
+inline void PanZoomTestCheck(bool condition, const char* expression, const char* file, int line)
+{
+    if (!condition)
+    {
+        fprintf(stderr, "%s:%d: check failed: %s\n", file, line, expression);
+        ++s_panZoomTestFailures;
+    }
+}
+
+inline int PanZoomTestResult()
+{
+    if (s_panZoomTestFailures)
+    {
+        fprintf(stderr, "%u check(s) failed\n", s_panZoomTestFailures);
+        return 1;
+    }
+    return 0;
+}
+
+#define PANZOOM_CHECK(condition) PanZoomTestCheck((condition), #condition, __FILE__, __LINE__)
+
+#endif // __PANZOOM_TEST_H__
@@ -0,0 +1,164 @@
+/*
+* CCLayerPanZoom
+*
+* Copyright (c) 2011 Alexey Lang
+* Copyright (c) 2011 Pavel Guganov
+*
+* http://www.cocos2d-x.org
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*
+*/
+
+#include "PanZoomTest.h"
+#include "PanZoomTileCache.h"
+
+static PanZoomTileKey key(int x)
+{
+    return PanZoomTileKeyMake(0, x, 0);
+}
+
+static void* tile(long n)
+{
+    return (void*)n;
+}
+
+// Whether the cached tiles, most recently used first, are tiles[0..count).
+static bool hasOrder(const PanZoomTileCache& cache, const long* tiles, unsigned int count)
+{
+    if (cache.tiles().size() != count)
+    {
+        return false;
+    }
+    PanZoomTileCache::TileList::const_iterator cached = cache.tiles().begin();
+    for (unsigned int i = 0; i < count; ++i, ++cached)
+    {
+        if (cached->tile != tile(tiles[i]) || !(cached->key == key((int)tiles[i])))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void testLeastRecentlyUsedOrder()
+{
+    PanZoomTileCache cache;
+    cache.insert(key(1), tile(1), 100);
+    cache.insert(key(2), tile(2), 100);
+    cache.insert(key(3), tile(3), 100);
+    const long inserted[] = { 3, 2, 1 };
+    PANZOOM_CHECK(hasOrder(cache, inserted, 3));
+    PANZOOM_CHECK(cache.count() == 3 && cache.memoryUsage() == 300);
+
+    PANZOOM_CHECK(cache.get(key(1)) == tile(1));
+    const long used[] = { 1, 3, 2 };
+    PANZOOM_CHECK(hasOrder(cache, used, 3));
+    // contains() doesn't count as a use.
+    PANZOOM_CHECK(cache.contains(key(2)));
+    PANZOOM_CHECK(hasOrder(cache, used, 3));
+
+    PANZOOM_CHECK(cache.get(key(4)) == NULL);
+    PANZOOM_CHECK(!cache.contains(key(4)));
+    PANZOOM_CHECK(cache.hits() == 1 && cache.misses() == 1 && cache.hitRate() == 0.5f);
+    cache.resetStatistics();
+    PANZOOM_CHECK(cache.hits() == 0 && cache.misses() == 0 && cache.hitRate() == 0.0f);
+}
+
+static void testBudgetEviction()
+{
+    PanZoomTileCache cache;
+    cache.setBudget(250);
+    cache.insert(key(1), tile(1), 100);
+    cache.insert(key(2), tile(2), 100);
+    std::vector<void*> evicted;
+    cache.evict(evicted);
+    PANZOOM_CHECK(evicted.empty());
+
+    cache.insert(key(3), tile(3), 100);
+    cache.get(key(1));
+    // Over budget, the least recently used tile goes.
+    cache.evict(evicted);
+    PANZOOM_CHECK(evicted.size() == 1 && evicted[0] == tile(2));
+    PANZOOM_CHECK(cache.memoryUsage() == 200 && !cache.contains(key(2)));
+    PANZOOM_CHECK(cache.evictions() == 1);
+
+    // Pinned tiles stay, even over budget.
+    cache.insert(key(4), tile(4), 100);
+    cache.insert(key(5), tile(5), 100);
+    cache.setPinned(key(3), true);
+    cache.setPinned(key(1), true);
+    cache.setBudget(300);
+    evicted.clear();
+    cache.evict(evicted);
+    PANZOOM_CHECK(evicted.size() == 1 && evicted[0] == tile(4));
+    PANZOOM_CHECK(cache.memoryUsage() == 300);
+    cache.setPinned(key(5), true);
+    cache.setBudget(250);
+    evicted.clear();
+    cache.evict(evicted);
+    PANZOOM_CHECK(evicted.empty() && cache.memoryUsage() == 300);
+
+    cache.unpinAll();
+    cache.setBudget(0);
+    cache.evict(evicted);
+    PANZOOM_CHECK(evicted.size() == 3 && evicted[0] == tile(3) && evicted[2] == tile(5));
+    PANZOOM_CHECK(cache.count() == 0 && cache.memoryUsage() == 0 && cache.evictions() == 5);
+}
+
+static void testInsertExistingKey()
+{
+    PanZoomTileCache cache;
+    cache.insert(key(1), tile(1), 100);
+    cache.insert(key(2), tile(2), 100);
+    cache.setPinned(key(1), true);
+
+    // Replaced in place, the old tile is handed back.
+    PANZOOM_CHECK(cache.insert(key(1), tile(11), 300) == tile(1));
+    PANZOOM_CHECK(cache.count() == 2 && cache.tiles().size() == 2);
+    PANZOOM_CHECK(cache.memoryUsage() == 400);
+    PANZOOM_CHECK(cache.tiles().front().tile == tile(11) && cache.tiles().front().pinned);
+    PANZOOM_CHECK(cache.get(key(1)) == tile(11));
+
+    cache.setBudget(300);
+    std::vector<void*> evicted;
+    cache.evict(evicted);
+    PANZOOM_CHECK(evicted.size() == 1 && evicted[0] == tile(2));
+
+    cache.unpinAll();
+    cache.setBudget(0);
+    evicted.clear();
+    cache.evict(evicted);
+    PANZOOM_CHECK(evicted.size() == 1 && evicted[0] == tile(11));
+    PANZOOM_CHECK(cache.memoryUsage() == 0);
+
+    cache.insert(key(1), tile(1), 100);
+    std::vector<void*> removed;
+    cache.clear(removed);
+    PANZOOM_CHECK(removed.size() == 1 && removed[0] == tile(1));
+    PANZOOM_CHECK(cache.count() == 0 && cache.memoryUsage() == 0);
+}
+
+int main()
+{
+    testLeastRecentlyUsedOrder();
+    testBudgetEviction();
+    testInsertExistingKey();
+    return PanZoomTestResult();
+}
@@ -0,0 +1,270 @@
+/*
+* CCLayerPanZoom
+*
+* Copyright (c) 2011 Alexey Lang
+* Copyright (c) 2011 Pavel Guganov
+*
+* http://www.cocos2d-x.org
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*
+*/
+
+#include "PanZoomTest.h"
+#include "PanZoomTileLoader.h"
+
+#include <unistd.h>
+
+// Stub decoder counting its calls per tile.
+class CountingTileDecoder : public PanZoomTileDecoder
+{
+public:
+    CountingTileDecoder(double delay)
+        : _stub(4, delay)
+    {
+        pthread_mutex_init(&_mutex, NULL);
+    }
+
+    ~CountingTileDecoder()
+    {
+        pthread_mutex_destroy(&_mutex);
+    }
+
+    virtual bool decode(const PanZoomTileKey& key, PanZoomTileImage& image)
+    {
+        pthread_mutex_lock(&_mutex);
+        _decoded.push_back(key);
+        pthread_mutex_unlock(&_mutex);
+        return _stub.decode(key, image);
+    }
+
+    std::vector<PanZoomTileKey> decoded()
+    {
+        pthread_mutex_lock(&_mutex);
+        std::vector<PanZoomTileKey> decoded = _decoded;
+        pthread_mutex_unlock(&_mutex);
+        return decoded;
+    }
+
+private:
+    PanZoomStubTileDecoder _stub;
+    pthread_mutex_t _mutex;
+    std::vector<PanZoomTileKey> _decoded;
+};
+
+static std::vector<PanZoomTileKey> makeTiles(int count)
+{
+    std::vector<PanZoomTileKey> tiles;
+    for (int i = 0; i < count; ++i)
+    {
+        tiles.push_back(PanZoomTileKeyMake(i % 3, i, i / 2));
+    }
+    return tiles;
+}
+
+static bool popTile(PanZoomTileLoader& loader, const PanZoomTileKey& expected)
+{
+    PanZoomTileKey key;
+    PanZoomTileImage image;
+    bool ok = false;
+    return loader.popDecoded(key, image, ok) && ok && key == expected && 
+        image.width == 4 && image.pixels.size() == 4 * 4 * 4 && 
+        image.pixels[0] == (unsigned char)(key.x * 40) && image.pixels[1] == (unsigned char)(key.y * 40);
+}
+
+static bool popNothing(PanZoomTileLoader& loader)
+{
+    PanZoomTileKey key;
+    PanZoomTileImage image;
+    bool ok;
+    return !loader.popDecoded(key, image, ok);
+}
+
+// Without threads each popDecoded() decodes the most urgent tile.
+static void testPriorityOrder()
+{
+    CountingTileDecoder decoder(0.0);
+    PanZoomTileLoader loader(&decoder, 0);
+    std::vector<PanZoomTileKey> tiles = makeTiles(4);
+
+    PANZOOM_CHECK(popNothing(loader));
+    loader.setWanted(tiles);
+    PANZOOM_CHECK(loader.pendingCount() == 4);
+    for (int i = 0; i < 4; ++i)
+    {
+        PANZOOM_CHECK(popTile(loader, tiles[i]));
+        PANZOOM_CHECK(loader.pendingCount() == (unsigned int)(3 - i));
+    }
+    PANZOOM_CHECK(popNothing(loader));
+    PANZOOM_CHECK(decoder.decoded() == tiles);
+}
+
+static void testSetWantedRequeues()
+{
+    CountingTileDecoder decoder(0.0);
+    PanZoomTileLoader loader(&decoder, 0);
+    std::vector<PanZoomTileKey> tiles = makeTiles(5);
+
+    std::vector<PanZoomTileKey> wanted(tiles.begin(), tiles.begin() + 3);
+    loader.setWanted(wanted);
+    PANZOOM_CHECK(popTile(loader, tiles[0]));
+
+    // New order, tiles[1] dropped, tiles[3] added.
+    wanted.clear();
+    wanted.push_back(tiles[3]);
+    wanted.push_back(tiles[2]);
+    loader.setWanted(wanted);
+    PANZOOM_CHECK(loader.pendingCount() == 2);
+    PANZOOM_CHECK(popTile(loader, tiles[3]));
+    PANZOOM_CHECK(popTile(loader, tiles[2]));
+    PANZOOM_CHECK(popNothing(loader));
+
+    // Popped tiles can be wanted again.
+    wanted.clear();
+    wanted.push_back(tiles[4]);
+    wanted.push_back(tiles[0]);
+    loader.setWanted(wanted);
+    PANZOOM_CHECK(popTile(loader, tiles[4]));
+    PANZOOM_CHECK(popTile(loader, tiles[0]));
+    PANZOOM_CHECK(loader.pendingCount() == 0);
+
+    std::vector<PanZoomTileKey> expected;
+    expected.push_back(tiles[0]);
+    expected.push_back(tiles[3]);
+    expected.push_back(tiles[2]);
+    expected.push_back(tiles[4]);
+    expected.push_back(tiles[0]);
+    PANZOOM_CHECK(decoder.decoded() == expected);
+
+    loader.setWanted(std::vector<PanZoomTileKey>());
+    PANZOOM_CHECK(loader.pendingCount() == 0);
+    PANZOOM_CHECK(popNothing(loader));
+}
+
+// Waits up to a few seconds for the workers to decode everything wanted.
+static bool waitForWorkers(PanZoomTileLoader& loader)
+{
+    for (int i = 0; i < 5000 && loader.pendingCount() > 0; ++i)
+    {
+        usleep(1000);
+    }
+    return loader.pendingCount() == 0;
+}
+
+static void testBusyTiles()
+{
+    CountingTileDecoder decoder(0.0);
+    PanZoomTileLoader loader(&decoder, 2);
+    std::vector<PanZoomTileKey> tiles = makeTiles(2);
+
+    std::vector<PanZoomTileKey> wanted(1, tiles[0]);
+    loader.setWanted(wanted);
+    PANZOOM_CHECK(waitForWorkers(loader));
+
+    // tiles[0] is decoded but not popped, it isn't queued again.
+    loader.setWanted(tiles);
+    PANZOOM_CHECK(waitForWorkers(loader));
+    PANZOOM_CHECK(decoder.decoded().size() == 2);
+
+    bool popped[2] = { false, false };
+    PanZoomTileKey key;
+    PanZoomTileImage image;
+    bool ok;
+    while (loader.popDecoded(key, image, ok))
+    {
+        for (int i = 0; i < 2; ++i)
+        {
+            if (key == tiles[i])
+            {
+                PANZOOM_CHECK(ok && !popped[i]);
+                popped[i] = true;
+            }
+        }
+    }
+    PANZOOM_CHECK(popped[0] && popped[1]);
+    PANZOOM_CHECK(loader.pendingCount() == 0);
+}
+
+// The owner keeps wanting the tiles it hasn't got, every tile comes once.
+static void testWorkersPopEachTileOnce()
+{
+    const int count = 64;
+    CountingTileDecoder decoder(0.0005);
+    PanZoomTileLoader loader(&decoder, 4);
+    std::vector<PanZoomTileKey> tiles = makeTiles(count);
+
+    std::vector<int> pops(count, 0);
+    std::vector<PanZoomTileKey> wanted = tiles;
+    for (int frame = 0; frame < 10000 && !wanted.empty(); ++frame)
+    {
+        loader.setWanted(wanted);
+        PanZoomTileKey key;
+        PanZoomTileImage image;
+        bool ok;
+        while (loader.popDecoded(key, image, ok))
+        {
+            PANZOOM_CHECK(ok);
+            ++pops[key.x];
+        }
+        wanted.clear();
+        for (int i = 0; i < count; ++i)
+        {
+            if (!pops[i])
+            {
+                wanted.push_back(tiles[i]);
+            }
+        }
+        usleep(500);
+    }
+    PANZOOM_CHECK(wanted.empty());
+    for (int i = 0; i < count; ++i)
+    {
+        PANZOOM_CHECK(pops[i] == 1);
+    }
+    PANZOOM_CHECK(decoder.decoded().size() == (size_t)count);
+    PANZOOM_CHECK(loader.pendingCount() == 0);
+}
+
+// Destroying the loader drops the queue and joins the workers mid-decode.
+static void testDestroyWithQueuedWork()
+{
+    const int count = 200;
+    CountingTileDecoder decoder(0.002);
+    {
+        PanZoomTileLoader loader(&decoder, 3);
+        loader.setWanted(makeTiles(count));
+        usleep(3000);
+        PANZOOM_CHECK(loader.pendingCount() > 0);
+    }
+    size_t decoded = decoder.decoded().size();
+    PANZOOM_CHECK(decoded < (size_t)count);
+    // No worker is left running.
+    usleep(10000);
+    PANZOOM_CHECK(decoder.decoded().size() == decoded);
+}
+
+int main()
+{
+    testPriorityOrder();
+    testSetWantedRequeues();
+    testBusyTiles();
+    testWorkersPopEachTileOnce();
+    testDestroyWithQueuedWork();
+    return PanZoomTestResult();
+}
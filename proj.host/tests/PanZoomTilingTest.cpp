@@ -0,0 +1,150 @@
+/*
+* CCLayerPanZoom
+*
+* Copyright (c) 2011 Alexey Lang
+* Copyright (c) 2011 Pavel Guganov
+*
+* http://www.cocos2d-x.org
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*
+*/
+
+#include "PanZoomTest.h"
+#include "PanZoomTiling.h"
+
+static void makeTiling(PanZoomTiling& tiling)
+{
+    tiling.contentSize = PanZoomSizeMake(1000.0f, 600.0f);
+    tiling.tileSize = 256.0f;
+    tiling.levelCount = 3;
+}
+
+static bool hasTile(const std::vector<PanZoomTileKey>& tiles, int level, int x, int y)
+{
+    for (size_t i = 0; i < tiles.size(); ++i)
+    {
+        if (tiles[i] == PanZoomTileKeyMake(level, x, y))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void testLevelForScale()
+{
+    PanZoomTiling tiling;
+    makeTiling(tiling);
+    PANZOOM_CHECK(tiling.levelForScale(2.0f) == 0);
+    PANZOOM_CHECK(tiling.levelForScale(1.0f) == 0);
+    PANZOOM_CHECK(tiling.levelForScale(0.51f) == 0);
+    PANZOOM_CHECK(tiling.levelForScale(0.5f) == 1);
+    PANZOOM_CHECK(tiling.levelForScale(0.49f) == 1);
+    PANZOOM_CHECK(tiling.levelForScale(0.25f) == 2);
+    // Clamped to the coarsest level.
+    PANZOOM_CHECK(tiling.levelForScale(0.125f) == 2);
+    PANZOOM_CHECK(tiling.levelForScale(0.01f) == 2);
+
+    tiling.levelCount = 1;
+    PANZOOM_CHECK(tiling.levelForScale(0.01f) == 0);
+}
+
+static void testTileGeometry()
+{
+    PanZoomTiling tiling;
+    makeTiling(tiling);
+    PANZOOM_CHECK(tiling.tileContentSize(0) == 256.0f);
+    PANZOOM_CHECK(tiling.tileContentSize(2) == 1024.0f);
+    PANZOOM_CHECK(tiling.columnCount(0) == 4 && tiling.rowCount(0) == 3);
+    PANZOOM_CHECK(tiling.columnCount(1) == 2 && tiling.rowCount(1) == 2);
+    PANZOOM_CHECK(tiling.columnCount(2) == 1 && tiling.rowCount(2) == 1);
+
+    PANZOOM_CHECK(PanZoomRectEqual(tiling.tileRect(PanZoomTileKeyMake(0, 1, 1)), 
+        PanZoomRectMake(256.0f, 256.0f, 256.0f, 256.0f)));
+    // Edge tiles end with the content.
+    PANZOOM_CHECK(PanZoomRectEqual(tiling.tileRect(PanZoomTileKeyMake(0, 3, 2)), 
+        PanZoomRectMake(768.0f, 512.0f, 232.0f, 88.0f)));
+    PANZOOM_CHECK(PanZoomRectEqual(tiling.tileRect(PanZoomTileKeyMake(1, 1, 1)), 
+        PanZoomRectMake(512.0f, 512.0f, 488.0f, 88.0f)));
+    PANZOOM_CHECK(PanZoomRectEqual(tiling.tileRect(PanZoomTileKeyMake(2, 0, 0)), 
+        PanZoomRectMake(0.0f, 0.0f, 1000.0f, 600.0f)));
+}
+
+static void testTilesInRect()
+{
+    PanZoomTiling tiling;
+    makeTiling(tiling);
+    std::vector<PanZoomTileKey> tiles;
+
+    tiling.tilesInRect(PanZoomRectMake(0.0f, 0.0f, 1000.0f, 600.0f), 0, tiles);
+    PANZOOM_CHECK(tiles.size() == 12 && hasTile(tiles, 0, 0, 0) && hasTile(tiles, 0, 3, 2));
+
+    // Clamped to the content.
+    tiles.clear();
+    tiling.tilesInRect(PanZoomRectMake(-100.0f, -100.0f, 2000.0f, 2000.0f), 0, tiles);
+    PANZOOM_CHECK(tiles.size() == 12 && hasTile(tiles, 0, 3, 2) && !hasTile(tiles, 0, 4, 2));
+    tiles.clear();
+    tiling.tilesInRect(PanZoomRectMake(-100.0f, -100.0f, 2000.0f, 2000.0f), 2, tiles);
+    PANZOOM_CHECK(tiles.size() == 1 && hasTile(tiles, 2, 0, 0));
+
+    // A rect ending on a tile edge doesn't reach the next tile.
+    tiles.clear();
+    tiling.tilesInRect(PanZoomRectMake(0.0f, 0.0f, 256.0f, 256.0f), 0, tiles);
+    PANZOOM_CHECK(tiles.size() == 1 && hasTile(tiles, 0, 0, 0));
+    // One starting on it does.
+    tiles.clear();
+    tiling.tilesInRect(PanZoomRectMake(256.0f, 0.0f, 1.0f, 1.0f), 0, tiles);
+    PANZOOM_CHECK(tiles.size() == 1 && hasTile(tiles, 0, 1, 0));
+
+    // Past the right and top content edges.
+    tiles.clear();
+    tiling.tilesInRect(PanZoomRectMake(990.0f, 590.0f, 100.0f, 100.0f), 0, tiles);
+    PANZOOM_CHECK(tiles.size() == 1 && hasTile(tiles, 0, 3, 2));
+    tiles.clear();
+    tiling.tilesInRect(PanZoomRectMake(700.0f, 500.0f, 1000.0f, 1000.0f), 1, tiles);
+    PANZOOM_CHECK(tiles.size() == 2 && hasTile(tiles, 1, 1, 0) && hasTile(tiles, 1, 1, 1));
+
+    // Outside the content.
+    tiles.clear();
+    tiling.tilesInRect(PanZoomRectMake(1000.0f, 0.0f, 10.0f, 10.0f), 0, tiles);
+    tiling.tilesInRect(PanZoomRectMake(-50.0f, -50.0f, 40.0f, 40.0f), 0, tiles);
+    tiling.tilesInRect(PanZoomRectMake(0.0f, 600.0f, 10.0f, 10.0f), 0, tiles);
+    PANZOOM_CHECK(tiles.empty());
+}
+
+static void testSortTilesByDistance()
+{
+    PanZoomTiling tiling;
+    makeTiling(tiling);
+    std::vector<PanZoomTileKey> tiles;
+    tiling.tilesInRect(PanZoomRectMake(0.0f, 0.0f, 1000.0f, 600.0f), 0, tiles);
+    tiling.sortTilesByDistance(tiles, PanZoomPointMake(900.0f, 560.0f));
+    PANZOOM_CHECK(tiles.front() == PanZoomTileKeyMake(0, 3, 2));
+    PANZOOM_CHECK(tiles.back() == PanZoomTileKeyMake(0, 0, 0));
+}
+
+int main()
+{
+    testLevelForScale();
+    testTileGeometry();
+    testTilesInRect();
+    testSortTilesByDistance();
+    return PanZoomTestResult();
+}
@@ -0,0 +1,250 @@
+/*
+* CCLayerPanZoom
+*
+* Copyright (c) 2011 Alexey Lang
+* Copyright (c) 2011 Pavel Guganov
+*
+* http://www.cocos2d-x.org
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*
+*/
+
+#include "PanZoomTest.h"
+#include "PanZoomBenchmark.h"
+#include "PanZoomTrace.h"
+
+#include <algorithm>
+#include <string.h>
+#include <vector>
+
+#define kPanZoomTraceTestPath "panzoom_trace_test.pzt"
+
+static PanZoomController prototypeController()
+{
+    PanZoomController controller = PanZoomBenchmark().prototype;
+    controller.state.rubberEffectRatio = 0.5f;
+    controller.flingEnabled = true;
+    controller.flingFriction = 3.0f;
+    controller.predictionTime = 0.02f;
+    controller.rotationEnabled = true;
+    controller.maxTouchDistanceToClick = 20.0f;
+    controller.rubberEffectRecoveryTime = 0.3f;
+    controller.frameSettings.leftMargin = 60.0f;
+    controller.frameSettings.maxSpeed = 800.0f;
+    const float curve[] = { 0.0f, 0.5f, 0.6f, 1.0f };
+    controller.frameSettings.setCustomSpeedCurve(curve, 4);
+    controller.frameSettings.speedCurve = kCCLayerPanZoomEdgeSpeedCurveCustom;
+    controller.frameSettings.precompute();
+    return controller;
+}
+
+// Records trace as the layer does: every event, and the transform after each
+// handler. Returns the number of transforms.
+static unsigned int record(const PanZoomTouchTrace& trace, const char* path)
+{
+    PanZoomController controller = prototypeController();
+    PanZoomTraceWriter writer;
+    if (!writer.open(path, controller))
+    {
+        return 0;
+    }
+    unsigned int transforms = 0;
+    PanZoomTracePlayer player(controller);
+    for (size_t i = 0; i < trace.size(); ++i)
+    {
+        writer.writeEvent(trace[i]);
+        if (player.play(trace[i]))
+        {
+            writer.writeTransform(controller.state);
+            ++transforms;
+        }
+    }
+    return writer.close() ? transforms : 0;
+}
+
+static std::vector<unsigned char> readFile(const char* path)
+{
+    std::vector<unsigned char> data;
+    FILE* file = fopen(path, "rb");
+    if (file)
+    {
+        int c;
+        while ((c = fgetc(file)) != EOF)
+        {
+            data.push_back((unsigned char)c);
+        }
+        fclose(file);
+    }
+    return data;
+}
+
+static void writeFile(const char* path, const std::vector<unsigned char>& data, size_t size)
+{
+    FILE* file = fopen(path, "wb");
+    if (file)
+    {
+        fwrite(&data[0], 1, size, file);
+        fclose(file);
+    }
+}
+
+static void testReplay()
+{
+    PanZoomTouchTrace trace;
+    PanZoomTraceOneFingerPan(trace, 200);
+    PanZoomTraceTwoFingerPinch(trace, 100);
+    PanZoomTraceMultiFingerPinch(trace, 100);
+    PanZoomTraceFling(trace, 100);
+    PanZoomTraceBeginEndChurn(trace, 50);
+    unsigned int transforms = record(trace, kPanZoomTraceTestPath);
+    PANZOOM_CHECK(transforms > 0);
+
+    PanZoomTraceRecording recording;
+    PANZOOM_CHECK(recording.load(kPanZoomTraceTestPath));
+    PANZOOM_CHECK(recording.events.size() == trace.size());
+    PANZOOM_CHECK(recording.transforms.size() == transforms);
+    PANZOOM_CHECK(recording.state.rubberEffectRatio == 0.5f);
+
+    // Bit exact with the settings it was recorded with, whatever the
+    // controller had, and the controller keeps its clock.
+    PanZoomController controller;
+    PanZoomClock* clock = controller.clock;
+    PANZOOM_CHECK(recording.replay(controller) == -1);
+    PANZOOM_CHECK(controller.clock == clock);
+    PANZOOM_CHECK(controller.flingEnabled && controller.flingFriction == 3.0f);
+
+    // Changed settings are caught at the first differing transform.
+    PanZoomTraceRecording changed = recording;
+    changed.settings.flingFriction = 5.0f;
+    controller = PanZoomController();
+    int mismatch = changed.replay(controller);
+    PANZOOM_CHECK(mismatch > 0 && (unsigned int)mismatch < transforms);
+    PANZOOM_CHECK(controller.clock == clock);
+}
+
+static void testSettings()
+{
+    PanZoomController recorded = prototypeController();
+    recorded.coalesceTouches = true;
+    recorded.flingMinVelocity = 12.0f;
+    recorded.frameSettings.topMargin = 40.0f;
+    PanZoomTraceWriter writer;
+    PANZOOM_CHECK(writer.open(kPanZoomTraceTestPath, recorded));
+    PANZOOM_CHECK(writer.close());
+
+    PanZoomTraceRecording recording;
+    PANZOOM_CHECK(recording.load(kPanZoomTraceTestPath));
+    PanZoomController controller;
+    recording.settings.applyTo(controller);
+    PANZOOM_CHECK(controller.flingEnabled && controller.flingFriction == 3.0f);
+    PANZOOM_CHECK(controller.flingMinVelocity == 12.0f);
+    PANZOOM_CHECK(controller.coalesceTouches && controller.rotationEnabled);
+    PANZOOM_CHECK(controller.predictionTime == 0.02f);
+    PANZOOM_CHECK(controller.maxTouchDistanceToClick == 20.0f);
+    PANZOOM_CHECK(controller.rubberEffectRecoveryTime == 0.3f);
+
+    const PanZoomFrameSettings& frame = controller.frameSettings;
+    const PanZoomFrameSettings& expected = recorded.frameSettings;
+    PANZOOM_CHECK(frame.topMargin == 40.0f && frame.leftMargin == 60.0f);
+    PANZOOM_CHECK(frame.bottomMargin == expected.bottomMargin && frame.rightMargin == expected.rightMargin);
+    PANZOOM_CHECK(frame.minSpeed == expected.minSpeed && frame.maxSpeed == 800.0f);
+    PANZOOM_CHECK(frame.speedCurve == kCCLayerPanZoomEdgeSpeedCurveCustom);
+    PANZOOM_CHECK(!memcmp(frame.customSpeedCurve, expected.customSpeedCurve, sizeof(frame.customSpeedCurve)));
+    // Derived values are recomputed.
+    PANZOOM_CHECK(!memcmp(frame.speedTable, expected.speedTable, sizeof(frame.speedTable)));
+    PANZOOM_CHECK(frame.inverseLeftMargin == expected.inverseLeftMargin);
+
+    remove(kPanZoomTraceTestPath);
+}
+
+static void testWriteFailure()
+{
+    // Writes to /dev/full fail with ENOSPC.
+    FILE* full = fopen("/dev/full", "wb");
+    if (!full)
+    {
+        return;
+    }
+    fclose(full);
+
+    PanZoomController controller = prototypeController();
+    PanZoomTraceWriter writer;
+    PANZOOM_CHECK(writer.open("/dev/full", controller));
+    PANZOOM_CHECK(!writer.failed());
+    PanZoomTouchTrace trace;
+    PanZoomTraceOneFingerPan(trace, 20);
+    for (size_t i = 0; i < trace.size(); ++i)
+    {
+        writer.writeEvent(trace[i]);
+    }
+    writer.flush();
+    PANZOOM_CHECK(writer.failed());
+    PANZOOM_CHECK(!writer.close());
+    PANZOOM_CHECK(!writer.isOpen());
+
+    // A new trace starts without the failure.
+    PANZOOM_CHECK(writer.open(kPanZoomTraceTestPath, controller));
+    PANZOOM_CHECK(!writer.failed());
+    PANZOOM_CHECK(writer.close());
+    remove(kPanZoomTraceTestPath);
+}
+
+static void testRejectedTraces()
+{
+    PanZoomTouchTrace trace;
+    PanZoomTraceOneFingerPan(trace, 20);
+    unsigned int transforms = record(trace, kPanZoomTraceTestPath);
+    std::vector<unsigned char> data = readFile(kPanZoomTraceTestPath);
+    PANZOOM_CHECK(data.size() > 8);
+    if (data.size() <= 8)
+    {
+        return;
+    }
+    PanZoomTraceRecording recording;
+
+    // Byte order probe of the other endianness.
+    std::vector<unsigned char> swapped = data;
+    std::swap(swapped[4], swapped[7]);
+    std::swap(swapped[5], swapped[6]);
+    writeFile(kPanZoomTraceTestPath, swapped, swapped.size());
+    PANZOOM_CHECK(!recording.load(kPanZoomTraceTestPath));
+
+    std::vector<unsigned char> badMagic = data;
+    badMagic[0] = 'X';
+    writeFile(kPanZoomTraceTestPath, badMagic, badMagic.size());
+    PANZOOM_CHECK(!recording.load(kPanZoomTraceTestPath));
+
+    // A trace cut inside a record keeps the complete records before it.
+    writeFile(kPanZoomTraceTestPath, data, data.size() - 3);
+    PANZOOM_CHECK(recording.load(kPanZoomTraceTestPath));
+    PANZOOM_CHECK(recording.events.size() == trace.size());
+    PANZOOM_CHECK(recording.transforms.size() == transforms - 1);
+
+    remove(kPanZoomTraceTestPath);
+}
+
+int main()
+{
+    testReplay();
+    testRejectedTraces();
+    testSettings();
+    testWriteFailure();
+    return PanZoomTestResult();
+}
@@ -0,0 +1,99 @@
+/*
+* CCLayerPanZoom
+*
+* Copyright (c) 2011 Alexey Lang
+* Copyright (c) 2011 Pavel Guganov
+*
+* http://www.cocos2d-x.org
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*
+*/
+
+#include "PanZoomTest.h"
+#include "PanZoomState.h"
+
+static void testDirtyFlags()
+{
+    PanZoomTransformVersion transform;
+    PANZOOM_CHECK(transform.version == 0);
+    PANZOOM_CHECK(transform.dirtyFlagsSince(0) == kCCLayerPanZoomDirtyNone);
+
+    transform.markDirty(kCCLayerPanZoomDirtyPosition);
+    PANZOOM_CHECK(transform.version == 1);
+    PANZOOM_CHECK(transform.dirtyFlagsSince(0) == kCCLayerPanZoomDirtyPosition);
+    PANZOOM_CHECK(transform.dirtyFlagsSince(1) == kCCLayerPanZoomDirtyNone);
+
+    transform.markDirty(kCCLayerPanZoomDirtyScale | kCCLayerPanZoomDirtyBounds);
+    PANZOOM_CHECK(transform.version == 2);
+    PANZOOM_CHECK(transform.dirtyFlagsSince(0) == 
+        (kCCLayerPanZoomDirtyPosition | kCCLayerPanZoomDirtyScale | kCCLayerPanZoomDirtyBounds));
+    PANZOOM_CHECK(transform.dirtyFlagsSince(1) == (kCCLayerPanZoomDirtyScale | kCCLayerPanZoomDirtyBounds));
+
+    // A flag changed again only reports against versions before its last change.
+    transform.markDirty(kCCLayerPanZoomDirtyPosition);
+    PANZOOM_CHECK(transform.dirtyFlagsSince(2) == kCCLayerPanZoomDirtyPosition);
+    PANZOOM_CHECK(transform.dirtyFlagsSince(1) == 
+        (kCCLayerPanZoomDirtyPosition | kCCLayerPanZoomDirtyScale | kCCLayerPanZoomDirtyBounds));
+
+    transform.markDirty(kCCLayerPanZoomDirtyMode);
+    PANZOOM_CHECK(transform.dirtyFlagsSince(3) == kCCLayerPanZoomDirtyMode);
+    PANZOOM_CHECK(transform.dirtyFlagsSince(transform.version) == kCCLayerPanZoomDirtyNone);
+}
+
+// A consumer redrawing only on version changes, and rebuilding its layout
+// only when the bounds changed.
+static void testConsumer()
+{
+    PanZoomTransformVersion transform;
+    unsigned int handledVersion = transform.version;
+    unsigned int redraws = 0;
+    unsigned int relayouts = 0;
+
+    for (unsigned int frame = 0; frame < 100; ++frame)
+    {
+        if (frame % 10 == 0)
+        {
+            transform.markDirty(kCCLayerPanZoomDirtyPosition);
+        }
+        if (frame == 50)
+        {
+            transform.markDirty(kCCLayerPanZoomDirtyBounds);
+        }
+        if (transform.version == handledVersion)
+        {
+            continue;
+        }
+        ++redraws;
+        if (transform.dirtyFlagsSince(handledVersion) & kCCLayerPanZoomDirtyBounds)
+        {
+            ++relayouts;
+        }
+        handledVersion = transform.version;
+    }
+    PANZOOM_CHECK(redraws == 10);
+    PANZOOM_CHECK(relayouts == 1);
+}
+
+int main()
+{
+    testDirtyFlags();
+    testConsumer();
+    return PanZoomTestResult();
+}